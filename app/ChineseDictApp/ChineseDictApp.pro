@@ -1,5 +1,5 @@
-QT += quick svg xml
-CONFIG += c++11
+QT += quick svg xml concurrent
+CONFIG += c++14
 
 # The following define makes your compiler emit warnings if you use
 # any feature of Qt which as been marked deprecated (the exact warnings
@@ -7,6 +7,9 @@ CONFIG += c++11
 # deprecated API in order to know how to port your code away from it.
 DEFINES += QT_DEPRECATED_WARNINGS
 
+# debug output, see logging.h, is compiled out of release builds
+CONFIG(release, debug|release): DEFINES += QT_NO_DEBUG_OUTPUT
+
 # You can also make your code fail to compile if you use deprecated APIs.
 # In order to do so, uncomment the following line.
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
@@ -14,9 +17,17 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += main.cpp \
     textutils.cpp \
+    pinyinsyllables.cpp \
+    logging.cpp \
     qobjectlistmodel.cpp \
     dictdb.cpp \
     settings.cpp \
+    englishsearch.cpp \
+    detailscache.cpp \
+    headwordindex.cpp \
+    batchlookup.cpp \
+    segmenter.cpp \
+    textannotator.cpp \
     ../../sqlite-amalgamation-3220000/sqlite3.c
 
 RESOURCES += qml.qrc
@@ -40,9 +51,17 @@ INCLUDEPATH += ../../sqlite-amalgamation-3220000
 
 HEADERS += \
     textutils.h \
+    pinyinsyllables.h \
+    logging.h \
     qobjectlistmodel.h \
     dictdb.h \
     settings.h \
+    englishsearch.h \
+    detailscache.h \
+    headwordindex.h \
+    batchlookup.h \
+    segmenter.h \
+    textannotator.h \
     ../../sqlite-amalgamation-3220000/sqlite3.h
 
 DISTFILES += \
@@ -34,24 +34,16 @@ Page {
     property string toneNums
     property int listRowIndex
 
-    property string alsoPronounced
-    property string alsoWritten
-    property variant englishDefs: []
-    property variant classifiers: []
-    property variant componentCharacters: []
+    //everything from DictDb's detailsReady() for wordsKey, set in one go
+    property variant details: null
+
+    readonly property string alsoPronounced: details ? details.extraInfo.chinese.alsoPronounced : ""
+    readonly property string alsoWritten: details ? details.extraInfo.chinese.alsoWritten : ""
+    readonly property variant englishDefs: details ? details.extraInfo.english : []
+    readonly property variant classifiers: details ? details.classifiers : []
+    readonly property variant componentCharacters: details ? details.components : []
     property bool isFavourite
 
-    property variant extraInfo
-
-
-    onExtraInfoChanged: {
-        alsoPronounced = extraInfo.chinese.alsoPronounced
-        alsoWritten = extraInfo.chinese.alsoWritten
-        englishDefs = extraInfo.english
-        traditional = traditional
-        simplified = simplified
-    }
-
 
     Rectangle {
         anchors.fill: parent
@@ -98,6 +90,8 @@ Page {
 
 
     onWordsKeyChanged: {
+        //don't show the previous word's details while this one's are on their way
+        details = null
         isFavourite = settings.isFavourite(wordsKey)
         //console.log("wordsKey is now " + wordsKey + "  isFavourite? " + isFavourite)
     }
@@ -144,6 +144,14 @@ Pane {
 
                     } // optionsCol
 
+                    CheckBox {
+                        text: "Fuzzy Pinyin (zh/z, ch/c, sh/s, n/l, -ng/-n)"
+                        onCheckedChanged: settings.fuzzyPinyin = checked
+                        Component.onCompleted: {
+                            checked = settings.fuzzyPinyin
+                        }
+                    }
+
                     CheckBox {
                         text: "Use tone colours"
                         onCheckedChanged: settings.toneColorsEnabled = checked
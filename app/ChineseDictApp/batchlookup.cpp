@@ -0,0 +1,217 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <QDebug>
+#include <QHash>
+#include <QMutexLocker>
+#include <algorithm>
+
+#include <assert.h>
+#include <string.h>
+#include "batchlookup.h"
+#include "textutils.h"
+#include "logging.h"
+
+//how many rows the walk over headword_keys steps past without a match
+//before it seeks to the next key instead, about what a seek costs
+#define BATCH_SCAN_GAP 8
+
+static bool isMoreCommon(const LookupEntry& a, const LookupEntry& b)
+{
+    return a.wordRank < b.wordRank;
+}
+
+BatchLookup::BatchLookup(const QString& dbPath) :
+    m_db(NULL),
+    m_keyScanStmt(NULL),
+    m_wordsKeyQueryStmt(NULL)
+{
+    //the mutex serializes callers, so sqlite's own locking isn't needed
+    int ret = sqlite3_open_v2(dbPath.toUtf8(), &m_db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL);
+    if (ret != SQLITE_OK) {
+        qCWarning(lcSearch) << "BatchLookup: error opening " << dbPath;
+        sqlite3_close(m_db);
+        m_db = NULL;
+        return;
+    }
+
+    //keys are compared as utf8 bytes, the same as the sort in lookup()
+    prepareStatement("SELECT key, words_key FROM headword_keys WHERE key >= ? ORDER BY key",
+                     &m_keyScanStmt);
+    prepareStatement("SELECT rowid, traditional, simplified, pinyin, tone_nums, english, word_rank "
+                     "FROM words WHERE rowid = ?",
+                     &m_wordsKeyQueryStmt);
+}
+
+BatchLookup::~BatchLookup()
+{
+    sqlite3_finalize(m_keyScanStmt);
+    sqlite3_finalize(m_wordsKeyQueryStmt);
+    sqlite3_close(m_db);
+}
+
+void BatchLookup::prepareStatement(const QString& query, sqlite3_stmt** stmt)
+{
+    QByteArray queryUtf8 = query.toUtf8();
+    int ret = sqlite3_prepare_v2(m_db,
+        queryUtf8.constData(),
+        queryUtf8.size(),
+        stmt,
+        NULL);
+
+    if (ret != SQLITE_OK) {
+        qCWarning(lcSearch) << "Error preparing statement <" << query << "> ";
+        qCWarning(lcSearch) << "error: " << sqlite3_errmsg(m_db);
+      assert(false);
+    }
+    assert(stmt);
+}
+
+//orders keys as sqlite's BINARY collation and QByteArray do
+static int compareKey(const QByteArray& a, const char* b, int bLength)
+{
+    int order = memcmp(a.constData(), b, qMin(a.size(), bLength));
+    if (order != 0) return order;
+    return a.size() - bLength;
+}
+
+//fills wordsKeys[i] with the entries for sortedKeys[i].
+//the index is walked in key order alongside the sorted keys. the walk
+//steps on to a key that is close, and seeks to one that is far ahead,
+//e.g. from the pinyin keys over to the hanzi ones, so a list costs no
+//more than a seek per key however its keys are spread
+void BatchLookup::matchKeys(const QList<QByteArray>& sortedKeys, QList<QList<int> >& wordsKeys)
+{
+    sqlite3_stmt* stmt = m_keyScanStmt;
+    int count = sortedKeys.count();
+    int k = 0;
+    //rows stepped past since the last match or seek
+    int skipped = BATCH_SCAN_GAP;
+    while (k < count) {
+        if (skipped >= BATCH_SCAN_GAP) {
+            sqlite3_reset(stmt);
+            sqlite3_bind_text(stmt, 1, sortedKeys[k].constData(), sortedKeys[k].size(), SQLITE_TRANSIENT);
+            skipped = 0;
+        }
+        if (sqlite3_step(stmt) != SQLITE_ROW) break;
+
+        const char* key = (const char*)sqlite3_column_text(stmt, 0);
+        int keyLength = sqlite3_column_bytes(stmt, 0);
+        int order = 0;
+        while ((k < count) && ((order = compareKey(sortedKeys[k], key, keyLength)) < 0)) k++;
+        if (k == count) break;
+        if (order == 0) {
+            wordsKeys[k].append(sqlite3_column_int(stmt, 1));
+            skipped = 0;
+        } else {
+            skipped++;
+        }
+    }
+    sqlite3_reset(stmt);
+}
+
+//reads the entries for wordsKeys, sorting them first so
+//the words table is read in rowid order
+void BatchLookup::readEntries(QList<int> wordsKeys, QHash<int, LookupEntry>& entries)
+{
+    std::sort(wordsKeys.begin(), wordsKeys.end());
+    wordsKeys.erase(std::unique(wordsKeys.begin(), wordsKeys.end()), wordsKeys.end());
+
+    sqlite3_stmt* stmt = m_wordsKeyQueryStmt;
+    int i;
+    for (i=0; i < wordsKeys.count(); i++) {
+        sqlite3_bind_int(stmt, 1, wordsKeys[i]);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            LookupEntry entry;
+            entry.wordsKey = sqlite3_column_int(stmt, 0);
+            entry.traditional = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 1));
+            entry.simplified = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 2));
+            entry.pinyin = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 3));
+            entry.toneNums = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 4));
+            entry.english = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 5));
+            entry.wordRank = sqlite3_column_int(stmt, 6);
+            entries.insert(entry.wordsKey, entry);
+        }
+        sqlite3_reset(stmt);
+    }
+}
+
+QHash<int, LookupEntry> BatchLookup::entries(const QList<int>& wordsKeys)
+{
+    QHash<int, LookupEntry> result;
+    if (m_db == NULL) return result;
+
+    QMutexLocker locker(&m_mutex);
+    readEntries(wordsKeys, result);
+    return result;
+}
+
+QList<QList<LookupEntry> > BatchLookup::lookup(const QStringList& words)
+{
+    QList<QList<LookupEntry> > result;
+    int i;
+    for (i=0; i < words.count(); i++) {
+        result.append(QList<LookupEntry>());
+    }
+    if (m_db == NULL) return result;
+
+    QMutexLocker locker(&m_mutex);
+
+    QList<QByteArray> keys;
+    for (i=0; i < words.count(); i++) {
+        keys.append(makeLookupKey(words[i]).toUtf8());
+    }
+    QList<QByteArray> sortedKeys = keys;
+    sortedKeys.removeAll(QByteArray());
+    std::sort(sortedKeys.begin(), sortedKeys.end());
+    sortedKeys.erase(std::unique(sortedKeys.begin(), sortedKeys.end()), sortedKeys.end());
+    if (sortedKeys.isEmpty()) return result;
+
+    QList<QList<int> > keyWordsKeys;
+    for (i=0; i < sortedKeys.count(); i++) {
+        keyWordsKeys.append(QList<int>());
+    }
+    matchKeys(sortedKeys, keyWordsKeys);
+
+    //read each entry once, in rowid order
+    QList<int> allWordsKeys;
+    for (i=0; i < keyWordsKeys.count(); i++) {
+        allWordsKeys.append(keyWordsKeys[i]);
+    }
+    QHash<int, LookupEntry> entries;
+    readEntries(allWordsKeys, entries);
+
+    QList<QList<LookupEntry> > keyEntries;
+    for (i=0; i < sortedKeys.count(); i++) {
+        QList<LookupEntry> list;
+        int j;
+        for (j=0; j < keyWordsKeys[i].count(); j++) {
+            if (entries.contains(keyWordsKeys[i][j])) list.append(entries.value(keyWordsKeys[i][j]));
+        }
+        std::stable_sort(list.begin(), list.end(), isMoreCommon);
+        keyEntries.append(list);
+    }
+
+    for (i=0; i < words.count(); i++) {
+        QList<QByteArray>::const_iterator it =
+                std::lower_bound(sortedKeys.constBegin(), sortedKeys.constEnd(), keys[i]);
+        if ((it != sortedKeys.constEnd()) && (*it == keys[i])) {
+            result[i] = keyEntries[it - sortedKeys.constBegin()];
+        }
+    }
+    return result;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef BATCHLOOKUP_H
+#define BATCHLOOKUP_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include "sqlite3.h"
+
+struct LookupEntry {
+    int wordsKey;
+    QString traditional;
+    QString simplified;
+    QString pinyin;
+    QString toneNums;
+    QString english;
+    int wordRank;
+};
+
+//looks up whole lists of headwords or pinyin (e.g. a vocabulary list) in one call.
+//it has its own read only connection, so it can be called synchronously
+//from any thread, independently of DictDb's search thread.
+//the keys are sorted and deduplicated, then matched against the sorted
+//headword_keys table in one walk in key order, seeking only over long gaps,
+//rather than one query per word
+class BatchLookup
+{
+private:
+    sqlite3* m_db;
+    QMutex m_mutex;
+
+    sqlite3_stmt* m_keyScanStmt;
+    sqlite3_stmt* m_wordsKeyQueryStmt;
+
+    void prepareStatement(const QString& query, sqlite3_stmt** stmt);
+    void matchKeys(const QList<QByteArray>& sortedKeys, QList<QList<int> >& wordsKeys);
+    void readEntries(QList<int> wordsKeys, QHash<int, LookupEntry>& entries);
+
+public:
+    explicit BatchLookup(const QString& dbPath);
+    ~BatchLookup();
+
+    bool isOpen() const { return m_db != NULL; }
+
+    //for each of words, in the same order, the entries whose simplified,
+    //traditional or pinyin (toneless, tone marked or numbered) is exactly it,
+    //most common first. unknown words get an empty list
+    QList<QList<LookupEntry> > lookup(const QStringList& words);
+
+    //the entries for the given words keys, e.g. from a Segmenter
+    QHash<int, LookupEntry> entries(const QList<int>& wordsKeys);
+};
+
+#endif // BATCHLOOKUP_H
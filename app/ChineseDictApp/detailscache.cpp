@@ -0,0 +1,134 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <QMutexLocker>
+
+#include "detailscache.h"
+
+//allowance for the bookkeeping around each string, map and list
+#define VARIANT_OVERHEAD_BYTES 32
+
+static int variantBytes(const QVariant& value)
+{
+    switch (value.type()) {
+    case QVariant::String:
+        return VARIANT_OVERHEAD_BYTES + value.toString().length() * sizeof(QChar);
+    case QVariant::Map: {
+        QVariantMap map = value.toMap();
+        int bytes = VARIANT_OVERHEAD_BYTES;
+        QVariantMap::const_iterator it;
+        for (it = map.constBegin(); it != map.constEnd(); ++it) {
+            bytes += VARIANT_OVERHEAD_BYTES + it.key().length() * sizeof(QChar) + variantBytes(it.value());
+        }
+        return bytes;
+    }
+    case QVariant::List: {
+        QVariantList list = value.toList();
+        int bytes = VARIANT_OVERHEAD_BYTES;
+        int i;
+        for (i=0; i < list.count(); i++) {
+            bytes += variantBytes(list.at(i));
+        }
+        return bytes;
+    }
+    default:
+        return VARIANT_OVERHEAD_BYTES;
+    }
+}
+
+int DetailsCache::estimateBytes(const DetailsPayload& details)
+{
+    return variantBytes(details.extraInfo) + variantBytes(details.classifiers) +
+           variantBytes(details.components);
+}
+
+DetailsCache::DetailsCache(int maxBytes) :
+    m_cache(maxBytes),
+    m_hits(0),
+    m_misses(0)
+{
+}
+
+bool DetailsCache::find(int wordsKey, DetailsPayload& details)
+{
+    QMutexLocker locker(&m_mutex);
+    DetailsPayload* cached = m_cache.object(wordsKey);
+    if (cached == NULL) {
+        m_misses++;
+        return false;
+    }
+    m_hits++;
+    //the variants are implicitly shared, so this copy is cheap
+    details = *cached;
+    return true;
+}
+
+void DetailsCache::insert(int wordsKey, const DetailsPayload& details)
+{
+    int bytes = estimateBytes(details);
+    QMutexLocker locker(&m_mutex);
+    //a payload bigger than the whole budget is just not kept
+    m_cache.insert(wordsKey, new DetailsPayload(details), bytes);
+}
+
+bool DetailsCache::contains(int wordsKey) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.contains(wordsKey);
+}
+
+void DetailsCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.clear();
+}
+
+void DetailsCache::setMaxBytes(int maxBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.setMaxCost(maxBytes);
+}
+
+int DetailsCache::maxBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.maxCost();
+}
+
+int DetailsCache::bytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.totalCost();
+}
+
+int DetailsCache::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.count();
+}
+
+quint64 DetailsCache::hits() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+quint64 DetailsCache::misses() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
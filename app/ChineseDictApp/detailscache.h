@@ -0,0 +1,77 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef DETAILSCACHE_H
+#define DETAILSCACHE_H
+
+#include <QCache>
+#include <QMutex>
+#include <QVariant>
+
+//the budget when none is given, enough for a few thousand words
+#define DEFAULT_DETAILS_CACHE_BYTES (4 * 1024 * 1024)
+
+//the details page for one word. QML gets these as js objects and arrays,
+//with no json to build or parse
+struct DetailsPayload {
+    QVariantMap extraInfo;
+    QVariantList classifiers;
+    QVariantList components;
+
+    QVariantMap toVariantMap() const
+    {
+        QVariantMap map;
+        map.insert("extraInfo", extraInfo);
+        map.insert("classifiers", classifiers);
+        map.insert("components", components);
+        return map;
+    }
+};
+
+//assembled details payloads by words key, least recently used first out
+//once their estimated size goes over the byte budget.
+//it locks, so one cache can be shared by every DictDb in a server's pool
+class DetailsCache
+{
+private:
+    mutable QMutex m_mutex;
+    QCache<int, DetailsPayload> m_cache;
+    quint64 m_hits;
+    quint64 m_misses;
+
+public:
+    explicit DetailsCache(int maxBytes = DEFAULT_DETAILS_CACHE_BYTES);
+
+    //true and fills in details if wordsKey is cached, making it the most recent
+    bool find(int wordsKey, DetailsPayload& details);
+    void insert(int wordsKey, const DetailsPayload& details);
+    //doesn't count as a hit or miss, or change the order
+    bool contains(int wordsKey) const;
+    void clear();
+
+    void setMaxBytes(int maxBytes);
+    int maxBytes() const;
+    int bytes() const;
+    int count() const;
+    quint64 hits() const;
+    quint64 misses() const;
+
+    //roughly the memory payload takes up
+    static int estimateBytes(const DetailsPayload& details);
+};
+
+#endif // DETAILSCACHE_H
@@ -20,26 +20,93 @@
 #include <QDebug>
 #include <QVariant>
 #include <QRegularExpression>
-#include <QQmlPropertyMap>
 #include <QStandardPaths>
 #include <QStringList>
+#include <QHash>
+#include <QSet>
 #include <QChar>
+#include <QTimer>
 #include <unistd.h>
+#include <algorithm>
 
 #include <assert.h>
 #include "dictdb.h"
 #include "textutils.h"
+#include "pinyinsyllables.h"
+#include "logging.h"
 
+//the most english results we show, best first
+#define ENGLISH_RESULT_LIMIT 200
+//the most results we show for headwords containing the search anywhere
+#define INFIX_RESULT_LIMIT 1000
 
-DictDb::DictDb()
+//details are prefetched for this many of the top results, about a screenful
+#define PREFETCH_RESULT_COUNT 10
+//how long the results must stay the same before prefetching starts
+#define PREFETCH_DELAY_MS 300
+
+
+DictDb::DictDb() :
+    m_fuzzyPinyinEnabled(false)
+{
+#ifdef Q_OS_ANDROID
+   copyDbFromAssets();
+#endif
+   init(dbFilePath());
+}
+
+//for use without the app, e.g. from the command line tool
+DictDb::DictDb(const QString& dbPath) :
+    m_fuzzyPinyinEnabled(false)
 {
-   if (!openDb()) {
-       qDebug() << "error, could not find db file";
+   init(dbPath);
+}
+
+void DictDb::init(const QString& dbPath)
+{
+   if (!openDb(dbPath)) {
+       qCWarning(lcSearch) << "error, could not find db file";
        exit(1);
    }
 
    makeStatements();
 
+   m_englishSearch = new EnglishSearch(db);
+
+   loadHeadwordIndex();
+
+   m_detailsCache = &m_ownDetailsCache;
+
+   //so the first few searches don't have to grow them
+   m_pinyinQueries.text.reserve(64);
+   m_pinyinQueries.pinyin.reserve(64);
+   m_pinyinQueries.syllables.reserve(64);
+   m_pinyinQueries.fuzzy.reserve(64);
+   m_queryUtf8.reserve(256);
+   m_resultRowids.reserve(256);
+
+   //a child, so it moves to m_thread with us in start()
+   m_prefetchTimer = new QTimer(this);
+   m_prefetchTimer->setSingleShot(true);
+   connect(m_prefetchTimer, SIGNAL(timeout()), this, SLOT(onPrefetchTimeout()));
+}
+
+//the suffix array for searching inside headwords is prebuilt by dbcreator
+void DictDb::loadHeadwordIndex()
+{
+    sqlite3_stmt* stmt;
+    QString query = "SELECT data FROM headword_index";
+    prepareStatement(query, &stmt);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        QByteArray data((const char*)sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0));
+        if (m_headwordIndex.deserialize(data)) {
+            qCDebug(lcSearch) << "headword index: " << m_headwordIndex.entryCount() << " entries, "
+                             << m_headwordIndex.byteSize() << " bytes";
+        }
+    } else {
+        qCWarning(lcSearch) << "no headword_index in db";
+    }
+    sqlite3_finalize(stmt);
 }
 
 void DictDb::start() {
@@ -47,14 +114,27 @@ void DictDb::start() {
     moveToThread(&m_thread);
 }
 
-bool DictDb::openDb()
+//where the app opens the words db from, e.g. for a BatchLookup.
+//on android it is only there once copyDbFromAssets() has run
+QString DictDb::dbFilePath()
 {
-
 #ifdef Q_OS_ANDROID
-    QFile dbFile("assets:/words.db");
     QString filePath = QStandardPaths::writableLocation( QStandardPaths::StandardLocation::AppLocalDataLocation );
     filePath.append( "/words.db");
-    qDebug() << "filePath is" << filePath;
+#else
+    QString dbDirectory = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);  //TODO
+    QString filePath = dbDirectory + "/words.db";
+#endif
+    return filePath;
+}
+
+#ifdef Q_OS_ANDROID
+//the db is shipped as an asset, sqlite needs it as a real file
+void DictDb::copyDbFromAssets()
+{
+    QString filePath = dbFilePath();
+    QFile dbFile("assets:/words.db");
+    qCDebug(lcSearch) << "filePath is" << filePath;
     if (dbFile.exists()) {
         if( QFile::exists( filePath ) )
             QFile::remove( filePath );
@@ -62,16 +142,17 @@ bool DictDb::openDb()
         if( dbFile.copy( filePath ) )
             QFile::setPermissions( filePath, QFile::WriteOwner | QFile::ReadOwner );
     }
-#else
-    QString dbDirectory = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);  //TODO
-    QString filePath = dbDirectory + "/words.db";
+}
 #endif
+
+bool DictDb::openDb(const QString& filePath)
+{
     int ret = sqlite3_open_v2(filePath.toUtf8(), &db, SQLITE_OPEN_READONLY, NULL);
     if ((ret == SQLITE_OK) && (db != NULL)) {
-        qDebug() << "words db exists, opened ok";
+        qCDebug(lcSearch) << "words db exists, opened ok";
         return true;
     }
-    qDebug() << "Error opening " << filePath;
+    qCWarning(lcSearch) << "Error opening " << filePath;
     return false;
 }
 
@@ -87,8 +168,8 @@ void DictDb::prepareStatement(QString& query, sqlite3_stmt** stmt)
         NULL);
 
     if (ret != SQLITE_OK) {
-        qDebug() << "Error preparing statement <" << query << "> ";
-        qDebug() << "error: " << sqlite3_errmsg(db);
+        qCWarning(lcSearch) << "Error preparing statement <" << query << "> ";
+        qCWarning(lcSearch) << "error: " << sqlite3_errmsg(db);
       assert(false);
     }
     assert(stmt);
@@ -131,23 +212,46 @@ void DictDb::makeStatements()
             "ORDER BY word_rank ASC ";
     prepareStatement(query, &m_tonelessPinyinQueryStmt);
 
-    //_englishQueryStmt
+    //m_fuzzyPinyinQueryStmt: toneless pinyin with confusable sounds folded together
     query =
             "SELECT rowid,* "
-            "FROM words WHERE english MATCH ? "
+            "FROM words WHERE "
+            "pinyin_fuzzy MATCH ? "
             "ORDER BY word_rank ASC ";
-    prepareStatement(query, &m_englishQueryStmt);
+    prepareStatement(query, &m_fuzzyPinyinQueryStmt);
 
-    //FIXME worth bothering with??
-    //_englishShortQueryStmt: used when there are likely to be an enormous number of
-    //useless results
+    //m_initialsPinyinQueryStmt: first letter of each syllable, e.g. "zg" for zhōng guó
     query =
             "SELECT rowid,* "
-            "FROM words WHERE english MATCH ? "
-            "ORDER BY word_rank ASC "
-            "LIMIT 50;";
-    prepareStatement(query, &m_englishShortQueryStmt);
+            "FROM words WHERE "
+            "pinyin_initials MATCH ? "
+            "ORDER BY word_rank ASC ";
+    prepareStatement(query, &m_initialsPinyinQueryStmt);
 
+    //m_syllablePinyinQueryStmt: each typed syllable is a prefix of the matching syllable,
+    //bound to an anchored phrase e.g. "^zh* guo*"
+    query =
+            "SELECT rowid,* "
+            "FROM words WHERE "
+            "pinyin_syllables MATCH ? "
+            "ORDER BY word_rank ASC ";
+    prepareStatement(query, &m_syllablePinyinQueryStmt);
+
+    //m_mixedQueryStmt: hanzi mixed with pinyin. each position is a "zhong中" token,
+    //bound to anchored phrases e.g. "^zhong中 guo*"
+    query =
+            "SELECT rowid,* "
+            "FROM words WHERE "
+            "hanzi_syllables MATCH ? "
+            "ORDER BY word_rank ASC ";
+    prepareStatement(query, &m_mixedQueryStmt);
+
+    //m_hanziReadingsQueryStmt: used to find the readings of the hanzi in a mixed query,
+    //bound to e.g. "simplified:中 OR traditional:中"
+    query =
+            "SELECT traditional, simplified, pinyin_toneless "
+            "FROM words WHERE words MATCH ?";
+    prepareStatement(query, &m_hanziReadingsQueryStmt);
 
     //m_classifiersForWordQueryStmt: used to look up all words that use a classifier
     query =
@@ -163,8 +267,9 @@ void DictDb::makeStatements()
     prepareStatement(query, &m_wordsKeyQueryStmt);
 
     //m_componentQueryStmt: used in details page to look up individual characters in a definition
+    //bound to an OR of every distinct character in the word, e.g. "中 OR 國"
     query =
-        "SELECT english, simplified, pinyin, pinyin_toneless "
+        "SELECT traditional, english, simplified, pinyin, pinyin_toneless "
         "FROM words WHERE traditional MATCH ? "
         "ORDER BY word_rank ASC";
     prepareStatement(query, &m_componentQueryStmt);
@@ -179,6 +284,50 @@ void DictDb::makeStatements()
 
 }
 
+static void AppendSearchResultRow(QObjectList* results, sqlite3_stmt* stmt);
+
+//the full width ？ and ＊ typed with chinese input methods, made ascii
+static QString normalizeWildcards(const QString& search)
+{
+    QString normalized = search.trimmed();
+    normalized.replace(QChar(0xFF1F), '?');
+    normalized.replace(QChar(0xFF0A), '*');
+    return normalized;
+}
+
+//a leading '*' alone means "contains", anything else with '?' or '*' is a pattern.
+//search has been through normalizeWildcards()
+static bool isWildcardPattern(const QString& search)
+{
+    int start = 0;
+    while ((start < search.length()) && (search.at(start) == QChar('*'))) start++;
+    return (search.indexOf('?', start) >= 0) || (search.indexOf('*', start) >= 0);
+}
+
+//appends the rows for wordsKeys, keeping their order
+void DictDb::appendWordsKeyRows(QObjectList* results, const QList<int>& wordsKeys)
+{
+    sqlite3_stmt* stmt = m_wordsKeyQueryStmt;
+    int i;
+    for (i=0; i < wordsKeys.count(); i++) {
+        sqlite3_bind_int(stmt, 1, wordsKeys[i]);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            AppendSearchResultRow(results, stmt);
+        }
+        sqlite3_reset(stmt);
+    }
+}
+
+//text lowercased, without its spaces, appended to out
+static void appendSpacelessLower(const QString& text, QString& out)
+{
+    int i;
+    for (i=0; i < text.length(); i++) {
+        QChar c = text.at(i);
+        if (c != QChar(' ')) out += c.toLower();
+    }
+}
+
 static void AppendSearchResultRow(QObjectList* results, sqlite3_stmt* stmt)
 {
     int rowid = sqlite3_column_int(stmt, 0);
@@ -210,31 +359,49 @@ static void AppendSearchResultRow(QObjectList* results, sqlite3_stmt* stmt)
 
 void DictDb::onMatchChineseAsync(const QString& search)
 {
+    cancelPrefetch();
+    emit clearAndDeleteResultList();
+
+    if (search.length() == 0) return;
 
+    emit searchInProgressChanged(true);
+
+    QObjectList* results = matchChinese(search);
+    startPrefetch(results);
+    emit changeResultList(results);
+
+    emit searchInProgressChanged(false);
+}
+
+QObjectList* DictDb::matchChinese(const QString& search)
+{
     //we need to cope with
     //1  simplified hanzi
     //2. traditional hanzi
     //3.1 'toneless' pinyin (i.e. no tonemarks or numbers)
     //3.2 pinyin with numbers
     //3.3 pinyin with tonemarks
+    //3.4 pinyin initials only, e.g. "zg" for zhōng guó, or "zh" for zhōng huá.
+    //    syllables with no vowel, e.g. "ng", look the same
+    //3.5 toneless pinyin with syllable boundaries, e.g. "zh guo"
     //4. 'CL:' special mode to search by classifier
-    qDebug() << "searching for " << search;
+    //4.1 '*' special mode to find hanzi anywhere in a headword, e.g. "*学"
+    //4.2 '?' and '*' wildcards for whole headwords, e.g. "一?不?", "中*国"
+    //5. hanzi mixed with toneless pinyin, e.g. "中guo"
+    qCDebug(lcSearch) << "searching for " << search;
 
     sqlite3_stmt* stmt = NULL;
     int ret;
-    emit clearAndDeleteResultList();
-
-    if (search.length() == 0) return;
-
-    emit searchInProgressChanged(true);
 
     QObjectList* results = new QObjectList;
+    if (search.length() == 0) return results;
 
     //sleep(1); //to test delays
 
     textFormat_t textFormat = determineTextFormat(search);
 
-    if (textFormat == tfHanzi) {
+    if ((textFormat == tfHanzi) || (textFormat == tfMixed)) {
+        QString wildcardSearch = normalizeWildcards(search);
         if (search.startsWith("CL:")) {
             //SPECIAL MODE - search for classifers!
             QString query = search + "*";
@@ -245,6 +412,17 @@ void DictDb::onMatchChineseAsync(const QString& search)
             while((ret = sqlite3_step(stmt)) == SQLITE_ROW) {
                 AppendSearchResultRow(results, stmt);
             }
+        } else if (isWildcardPattern(wildcardSearch) && (textFormat == tfHanzi)) {
+            //SPECIAL MODE - wildcard pattern over whole headwords
+            QString pattern = wildcardSearch;
+            pattern.remove(' ');
+            appendWordsKeyRows(results, m_headwordIndex.findPattern(pattern, INFIX_RESULT_LIMIT));
+        } else if (wildcardSearch.startsWith('*') && (textFormat == tfHanzi)) {
+            //SPECIAL MODE - contains the characters anywhere, not just at the start
+            QString pattern = wildcardSearch;
+            pattern.remove('*');
+            pattern.remove(' ');
+            appendWordsKeyRows(results, m_headwordIndex.find(pattern, INFIX_RESULT_LIMIT));
         } else {
             //regular character search
             //qDebug() << "seems to be characters...";
@@ -265,109 +443,212 @@ void DictDb::onMatchChineseAsync(const QString& search)
                     AppendSearchResultRow(results, stmt);
                 }
             }
+            if ((results->count() == 0) && (textFormat == tfMixed)) {
+                //not a headword that happens to contain latin letters (e.g. "卡拉OK"),
+                //so treat it as hanzi and pinyin syllables mixed together
+                sqlite3_reset(stmt);
+                stmt = m_mixedQueryStmt;
+                QString mixedQuery = makeMixedQuery(splitMixedSearchText(search));
+                if (!mixedQuery.isEmpty()) {
+                    sqlite3_bind_text(stmt, 1, mixedQuery.toUtf8(), -1, SQLITE_TRANSIENT);
+                    while((ret = sqlite3_step(stmt)) == SQLITE_ROW) {
+                        AppendSearchResultRow(results, stmt);
+                    }
+                }
+            }
         }
 
     } else {
         //some form of pinyin
 
-        //remove spaces and make lowercase
-        QString query = search.toLower();
-        query.remove(' ');
-
-        if (textFormat == tfPinyinNoTones) {
-            //remove umaluts, the toneless column treats them as "u"
-            //query.replace(QString::fromWCharArray(L"ü"), QChar('u'));
-            //query.replace(QString("u:"), QChar('u'));
-            //query.replace(QString("v"), QChar('u'));
-
+        //every query goes into buffers kept between searches, and is bound
+        //from m_queryUtf8 without sqlite copying it, so once they have
+        //grown nothing here allocates but the results themselves
+        makePinyinSearchQueries(search, textFormat, m_fuzzyPinyinEnabled, m_pinyinQueries);
+        const QString& query = m_pinyinQueries.text;
+        if (textFormat == tfPinyinInitials) {
+            //qDebug() <<  "pinyin initials";
+            stmt = m_initialsPinyinQueryStmt;
+        } else if (textFormat == tfPinyinNoTones) {
             //qDebug() <<  "toneless pinyin";
             stmt = m_tonelessPinyinQueryStmt;
-            query = makeTonelessSearchPinyin(query);
         } else {
+            //numbered pinyin converted to tonemarks, or already tonemarked
             stmt = m_pinyinQueryStmt;
-            if (textFormat == tfPinyinNumbers) {
-                query = makeToneMarkedSearchPinyin(query);
-                //qDebug() << " numbered pinyin, converted to " << query;
-            } // else already tonemarked pinyin
         }
-        sqlite3_bind_text(stmt, 1, query.toUtf8(), -1, SQLITE_TRANSIENT);
+        bindQuery(stmt, m_pinyinQueries.pinyin);
 
+        //rowids already in the results, sorted after each query
+        m_resultRowids.resize(0);
         while((ret = sqlite3_step(stmt)) == SQLITE_ROW) {
+            m_resultRowids.append(sqlite3_column_int(stmt, 0));
             AppendSearchResultRow(results, stmt);
         }
-    }
+        std::sort(m_resultRowids.begin(), m_resultRowids.end());
 
-    qDebug() << "got " << results->count() << " results";
+        if ((textFormat == tfPinyinInitials) && isVowellessSyllable(query.constData(), query.length())) {
+            //a whole syllable with no vowel, e.g. "ng" or "hm", is also
+            //matched exactly as toneless pinyin. anything else is left to the
+            //initials column, a prefix such as "zh*" would match thousands
+            sqlite3_reset(stmt);
+            stmt = m_tonelessPinyinQueryStmt;
+            bindQuery(stmt, query);
+            appendNewResultRows(results, stmt);
+        }
 
-    sqlite3_reset(stmt);
+        if ((textFormat == tfPinyinNoTones) && !m_pinyinQueries.syllables.isEmpty()) {
+            //the search splits into syllables, typed or found by the
+            //pinyin DFA, so also match each syllable as a prefix of the
+            //corresponding one in the entry
+            sqlite3_reset(stmt);
+            stmt = m_syllablePinyinQueryStmt;
+            bindQuery(stmt, m_pinyinQueries.syllables);
+            appendNewResultRows(results, stmt);
+        }
 
-    emit changeResultList(results);
+        if ((textFormat == tfPinyinNoTones) && m_fuzzyPinyinEnabled) {
+            //fuzzy matches go after all the exact and per-syllable ones
+            sqlite3_reset(stmt);
+            stmt = m_fuzzyPinyinQueryStmt;
+            bindQuery(stmt, m_pinyinQueries.fuzzy);
+            appendNewResultRows(results, stmt);
+        }
+    }
 
-    emit searchInProgressChanged(false);
+    qCDebug(lcSearch) << "got " << results->count() << " results";
+
+    if (stmt != NULL) sqlite3_reset(stmt);
+
+    return results;
 }
 
 
-void DictDb::onMatchEnglishAsync(const QString& search)
+//binds query as utf-8 from m_queryUtf8, which sqlite doesn't copy.
+//it stays bound until the next bindQuery(), so stmt must be reset before then
+void DictDb::bindQuery(sqlite3_stmt* stmt, const QString& query)
 {
-    sqlite3_stmt* stmt;
+    setUtf8(query.constData(), query.length(), m_queryUtf8);
+    sqlite3_bind_text(stmt, 1, m_queryUtf8.constData(), m_queryUtf8.length(), SQLITE_STATIC);
+}
 
-    emit clearAndDeleteResultList();
-/*
-    stmt = m_allWordsQueryStmt;
-    sqlite3_bind_text(stmt, 1, search.toUtf8(), -1, SQLITE_TRANSIENT);
-    emit searchInProgressChanged(true);
-    QObjectList* results = new QObjectList;
-    int ret;
-    while((ret = sqlite3_step(stmt)) == SQLITE_ROW) {
+//appends the rows of stmt that aren't already in m_resultRowids,
+//then adds them to it
+void DictDb::appendNewResultRows(QObjectList* results, sqlite3_stmt* stmt)
+{
+    int sortedCount = m_resultRowids.count();
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int rowid = sqlite3_column_int(stmt, 0);
+        if (std::binary_search(m_resultRowids.constBegin(), m_resultRowids.constBegin() + sortedCount, rowid)) {
+            continue;
+        }
+        m_resultRowids.append(rowid);
         AppendSearchResultRow(results, stmt);
     }
+    std::sort(m_resultRowids.begin(), m_resultRowids.end());
+}
 
-    sqlite3_reset(stmt);
-    emit changeResultList(results);
-
-    emit searchInProgressChanged(false);
-*/
-    if (search.length() == 0) return;
-
-    emit searchInProgressChanged(true);
-
-    //if the user types "a" they will get thousands of
-    //results which are probably not useful and will
-    //make it run very slowly.
-    //so we limit the number of results for less than 3 letters
+//the most phrases we will OR together for a mixed query,
+//when several of its hanzi have more than one reading
+#define MAX_MIXED_QUERY_PHRASES 32
 
-    if (search.length() < 3) {
-        stmt = m_englishShortQueryStmt;
-        //qDebug() << " using limited query for " << search;
-    } else {
-        //qDebug() << " using long query for " << search;
-        stmt = m_englishQueryStmt;
+//builds a query for m_mixedQueryStmt from the output of splitMixedSearchText().
+//hanzi positions are replaced by their possible "zhong中" tokens and
+//pinyin positions become prefixes, e.g. "^zhong中 guo*"
+//returns an empty string if one of the hanzi is unknown
+QString DictDb::makeMixedQuery(const QStringList& positions)
+{
+    //find the readings of every distinct hanzi in one query
+    QStringList readingTerms;
+    int i;
+    for (i=0; i < positions.count(); i++) {
+        const QString& position = positions.at(i);
+        if (isHanzi(position) && !readingTerms.contains("simplified:" + position)) {
+            readingTerms.append("simplified:" + position);
+            readingTerms.append("traditional:" + position);
+        }
     }
 
-    sqlite3_bind_text(stmt, 1, search.toUtf8(), -1, SQLITE_TRANSIENT);
+    QHash<QString, QStringList> readings;
+    if (!readingTerms.isEmpty()) {
+        int ret;
+        sqlite3_stmt* stmt = m_hanziReadingsQueryStmt;
+        sqlite3_bind_text(stmt, 1, readingTerms.join(" OR ").toUtf8(), -1, SQLITE_TRANSIENT);
+        while ((ret = sqlite3_step(stmt)) == SQLITE_ROW) {
+            QString traditional = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 0));
+            QString simplified = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 1));
+            QString toneless = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 2));
+            //the column is made from simplified characters
+            QString token = toneless + simplified;
+            if (!readings[traditional].contains(token)) readings[traditional].append(token);
+            if (!readings[simplified].contains(token)) readings[simplified].append(token);
+        }
+        sqlite3_reset(stmt);
+    }
 
+    //expand into one phrase per combination of readings
+    QList<QStringList> phrases;
+    phrases.append(QStringList());
+    for (i=0; i < positions.count(); i++) {
+        const QString& position = positions.at(i);
+        QStringList alternatives;
+        if (isHanzi(position)) {
+            alternatives = readings.value(position);
+            if (alternatives.isEmpty()) return QString();
+        } else {
+            alternatives.append(position + "*");
+        }
 
-    //QTime myTimer;
-    //myTimer.start();
+        QList<QStringList> expanded;
+        int phraseIndex;
+        for (phraseIndex=0; phraseIndex < phrases.count(); phraseIndex++) {
+            int alternativeIndex;
+            for (alternativeIndex=0; alternativeIndex < alternatives.count(); alternativeIndex++) {
+                if (expanded.count() >= MAX_MIXED_QUERY_PHRASES) break;
+                expanded.append(QStringList(phrases.at(phraseIndex)) << alternatives.at(alternativeIndex));
+            }
+        }
+        phrases = expanded;
+    }
 
-    QObjectList* results = new QObjectList;
-    int ret;
-    while((ret = sqlite3_step(stmt)) == SQLITE_ROW) {
-        AppendSearchResultRow(results, stmt);
+    QStringList query;
+    for (i=0; i < phrases.count(); i++) {
+        query.append("\"^" + phrases.at(i).join(' ') + "\"");
     }
+    //qDebug() << "mixed query: " << query;
+    return query.join(" OR ");
+}
 
-    sqlite3_reset(stmt);
+void DictDb::onMatchEnglishAsync(const QString& search)
+{
+    cancelPrefetch();
+    emit clearAndDeleteResultList();
 
-    //int nMilliseconds = myTimer.elapsed();
-    //qDebug() << "got " << results->count() << " results in " << (float)(nMilliseconds)/1000 << "secs";
+    if (search.length() == 0) return;
 
+    emit searchInProgressChanged(true);
+
+    QObjectList* results = matchEnglish(search);
+    startPrefetch(results);
     emit changeResultList(results);
 
     emit searchInProgressChanged(false);
+}
 
+QObjectList* DictDb::matchEnglish(const QString& search)
+{
+    //ranked best first, by how well the english matches and by word_rank.
+    //a single partly typed word mostly comes from the best entries dbcreator
+    //stored for its prefix, and common words such as "a" skip their own
+    //postings, so a keystroke stays cheap
+    QObjectList* results = new QObjectList;
+    if (search.length() == 0) return results;
+
+    QList<int> wordsKeys = m_englishSearch->match(search, ENGLISH_RESULT_LIMIT);
+    appendWordsKeyRows(results, wordsKeys);
+    return results;
 }
 
-void DictDb::sendExtraInfo
+QVariantMap DictDb::extraInfoPayload
     (int wordsKey,
      const QString& rawEnglish,
      const QString& alsoWritten,
@@ -375,55 +656,56 @@ void DictDb::sendExtraInfo
 {
     //QTime myTimer;
     //myTimer.start();
-    QString englishJson = "[";
+    QVariantList englishList;
     QStringList definitions = rawEnglish.split("/");
+    QRegExp hanziPairMatch("(([\\x4e00-\\x9fa5]+)|([\\x4e00-\\x9fa5]+)\\|([\\x4e00-\\x9fa5]+))");
     int i;
     for (i=0; i < definitions.count(); i++) {
-        QString def = definitions[i];
-        def.replace("\"", "\\\"");
-        if (i > 0) englishJson += ",";
-        englishJson += "{ \"english\": \"" + def + "\", \"inlineChinese\": [";
-        QRegExp hanziPairMatch("(([\\x4e00-\\x9fa5]+)|([\\x4e00-\\x9fa5]+)\\|([\\x4e00-\\x9fa5]+))");
+        const QString& def = definitions[i];
+        QVariantList inlineChinese;
         int pos = 0;
-        int foundHanzi = 0;
         while ((pos = hanziPairMatch.indexIn(def, pos)) != -1) {
             //qDebug() << " " << hanziPairMatch.cap(1);
-            if (foundHanzi > 0) englishJson += ",";
-            englishJson += "\"" + hanziPairMatch.cap(1) + "\"";
-            foundHanzi++;
+            inlineChinese.append(hanziPairMatch.cap(1));
             pos += hanziPairMatch.matchedLength();
         }
-        englishJson += "]}";
-
+        QVariantMap definition;
+        definition.insert("english", def);
+        definition.insert("inlineChinese", inlineChinese);
+        englishList.append(definition);
     }
-    englishJson += "]";
-    //qDebug() << "englishJson = " << englishJson;
-
-    QString chineseJson = "{\n";
-    chineseJson += " \"alsoWritten\": \"" + alsoWritten + "\", \n";
-    chineseJson += " \"alsoPronounced\": \"" + alsoPronounced + "\"\n";
-    chineseJson += "}";
-    //qDebug() << "chineseJson = " << chineseJson;
-
-    QString extraInfoJson = "{";
-    extraInfoJson += "\"wordsKey\": " + QString::number(wordsKey) + ",\n";
-    extraInfoJson += "\"english\": " + englishJson + ",\n";
-    extraInfoJson += "\"chinese\": " + chineseJson + "\n";
-    extraInfoJson += "}";
-    //qDebug() << "extraInfoJson = " << extraInfoJson;
-    emit extraInfoChanged(extraInfoJson);
+
+    QVariantMap chinese;
+    chinese.insert("alsoWritten", alsoWritten);
+    chinese.insert("alsoPronounced", alsoPronounced);
+
+    QVariantMap extraInfo;
+    extraInfo.insert("wordsKey", wordsKey);
+    extraInfo.insert("english", englishList);
+    extraInfo.insert("chinese", chinese);
+    //qDebug() << "extraInfo = " << extraInfo;
 
     //int nMilliseconds = myTimer.elapsed();
     //qDebug() << "sendBasicDefs took " << (float)nMilliseconds << "secs";
+    return extraInfo;
 }
 
 
-void DictDb::sendClassifiers(const QString& classifiers)
+QVariantList DictDb::resultsPayload(const QObjectList* results)
 {
-    QString classifiersJson = "[";
+    QVariantList list;
+    int i;
+    for (i=0; i < results->count(); i++) {
+        list.append(static_cast<SearchResult*>(results->at(i))->toVariantMap());
+    }
+    return list;
+}
+
+QVariantList DictDb::classifiersPayload(const QString& classifiers)
+{
+    QVariantList classifiersList;
     QStringList classifierList = classifiers.split(",");
     int i;
-    uint classifierCount = 0;
     for (i=0; i < classifierList.count(); i++) {
         QString classifierCharacter = classifierList[i];
 
@@ -449,42 +731,30 @@ void DictDb::sendClassifiers(const QString& classifiers)
         if (!english.isEmpty()) {
             //the english text should contain 1 or more classifier
             // split it into separate defs, and extract all the classifiers
-
-            if (classifierCount > 0) classifiersJson += ", ";
-            classifiersJson += "{ ";
-            classifiersJson += "\"traditional\": \"" + classifierCharacter + "\", ";
-            classifiersJson += "\"simplified\": \"" + simplified + "\", ";
-            classifiersJson += "\"pinyin\": \"" + pinyin + "\", ";
-            classifiersJson += "\"toneNums\": \"" + toneNum + "\", ";
-            classifiersJson += "\"english\": \"";
+            QStringList classifierDefs;
             QStringList definitions = english.split("/");
-
             int i;
-            uint defCount = 0;
             for (i=0; i < definitions.count(); i++) {
-                QString def = definitions[i];
-                if (def.startsWith("classifier")) {
-                    if (defCount > 0) classifiersJson += ";  ";
-                    classifiersJson += def;
-                    defCount++;
+                if (definitions[i].startsWith("classifier")) {
+                    classifierDefs.append(definitions[i]);
                 }
             }
 
-            if (defCount == 0) {
-                //no proper "classifier for" definition
-                //so just use the full english text
-                classifiersJson += english;
-            }
-
-            classifiersJson += "\" }";
-            classifierCount++;
+            QVariantMap classifier;
+            classifier.insert("traditional", classifierCharacter);
+            classifier.insert("simplified", simplified);
+            classifier.insert("pinyin", pinyin);
+            classifier.insert("toneNums", toneNum);
+            //with no proper "classifier for" definition
+            //we just use the full english text
+            classifier.insert("english", classifierDefs.isEmpty() ? english : classifierDefs.join(";  "));
+            classifiersList.append(classifier);
         } //english
         sqlite3_reset(m_traditionalQueryStmt);
     }
-    classifiersJson += "]";
-    //qDebug() << "dictDb: classifiersJson is " << classifiersJson;
+    //qDebug() << "dictDb: classifiers are " << classifiersList;
 
-    emit classifiersChanged(classifiersJson);
+    return classifiersList;
 }
 
 //if there are several matches we use a heuristic to try and get the right one
@@ -503,7 +773,15 @@ bool static isReasonableMatch
     return true;
 }
 
-void DictDb::sendComponentCharacters(const QString& characters, const QString& pinyin, const QString& toneNums)
+//one row returned by m_componentQueryStmt
+struct ComponentCandidate {
+    QString simplified;
+    QString english;
+    QString pinyin;
+    QString tonelessPinyin;
+};
+
+QVariantList DictDb::componentCharactersPayload(const QString& characters, const QString& pinyin, const QString& toneNums)
 {
     //some characters have multiple meanings
     //so we use the pinyin as an additional qualifier
@@ -512,25 +790,49 @@ void DictDb::sendComponentCharacters(const QString& characters, const QString& p
     QStringList toneNumList = toneNums.split(',');
 
     int charCount = characters.size();
-    qDebug() << pinyin << pinyinWordList << toneNumList << characters;
+    qCDebug(lcDetails) << pinyin << pinyinWordList << toneNumList << characters;
     /*
     if (pinyinWordList.count() != charCount) {
-        qDebug() << "Error, pinyin has " << pinyinWordList.count() << " characters, charCount has " << charCount;
+        qCWarning(lcDetails) << "Error, pinyin has " << pinyinWordList.count() << " characters, charCount has " << charCount;
         return;
     }
 */
     //qDebug() << pinyinWordList << toneNumList;
 
-    QString componentsJson = "[";
+    //look up every distinct character of the word in one go,
+    //e.g. "中 OR 國", rather than running one query per character.
+    //rows come back in word_rank order, so each candidate list is too
+    QHash<QString, QList<ComponentCandidate> > candidates;
+    QStringList distinctChars;
+    int charIndex;
+    for (charIndex=0; charIndex < charCount; charIndex++) {
+        QString currentChar = characters.at(charIndex);
+        if (isHanzi(currentChar) && !distinctChars.contains(currentChar)) {
+            distinctChars.append(currentChar);
+        }
+    }
 
-    int ret;
-    sqlite3_stmt* stmt = m_componentQueryStmt;
+    if (!distinctChars.isEmpty()) {
+        int ret;
+        sqlite3_stmt* stmt = m_componentQueryStmt;
+        QString query = distinctChars.join(" OR ");
+        sqlite3_bind_text(stmt, 1, query.toUtf8(), -1, SQLITE_TRANSIENT);
+        while ((ret = sqlite3_step(stmt)) == SQLITE_ROW) {
+            QString traditional = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 0));
+            ComponentCandidate candidate;
+            candidate.english = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 1));
+            candidate.simplified = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 2));
+            candidate.pinyin = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 3));
+            candidate.tonelessPinyin = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 4));
+            candidates[traditional].append(candidate);
+        }
+        sqlite3_reset(stmt);
+    }
+
+    QVariantList components;
 
-    int charIndex;
     int actualHanziIndex = 0;
     for (charIndex=0; charIndex < charCount; charIndex++) {
-        //QTime myTimer;
-        //myTimer.start();
         QString currentChar = characters.at(charIndex);
         if (isPunctuation(currentChar)) {
             //qDebug() << "skipping" << currentChar;
@@ -538,14 +840,12 @@ void DictDb::sendComponentCharacters(const QString& characters, const QString& p
         }
 
         if (actualHanziIndex >= toneNumList.count()) {
-            qDebug() << "Error, toneNumList has " << toneNumList.count() << " characters, toneNumIndex " << actualHanziIndex;
+            qCWarning(lcDetails) << "Error, toneNumList has " << toneNumList.count() << " characters, toneNumIndex " << actualHanziIndex;
             break;
         }
 
         QString simplified;
         QString matchEnglish;
-        QString matchPinyin;
-        QString matchTonelessPinyin;
         QString targetPinyin;
         QString targetToneNum = "5";
 
@@ -554,56 +854,93 @@ void DictDb::sendComponentCharacters(const QString& characters, const QString& p
             targetToneNum = toneNumList.at(actualHanziIndex);
 
             //qDebug() << "checking... currentChar: " << currentChar << " pinyin: " << targetPinyin;
-            sqlite3_bind_text(stmt, 1, currentChar.toUtf8(), -1, SQLITE_TRANSIENT);
-
-            do {
-                ret = sqlite3_step(stmt);
-                if (ret == SQLITE_ROW) {
-                    simplified = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 1));
-                    matchEnglish = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 0));
-                    matchPinyin = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 2));
-                    matchTonelessPinyin = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 3));
-                    //qDebug() << " match - english: " << english << " pinyin: " << matchPinyin << " currentChar: " << currentChar;
+            //as before, if nothing looks reasonable we settle for the last candidate
+            const QList<ComponentCandidate>& charCandidates = candidates[currentChar];
+            int i;
+            for (i=0; i < charCandidates.count(); i++) {
+                const ComponentCandidate& candidate = charCandidates.at(i);
+                simplified = candidate.simplified;
+                matchEnglish = candidate.english;
+                if (isReasonableMatch(candidate.english, candidate.pinyin, candidate.tonelessPinyin, targetPinyin)) {
+                    break;
                 }
-
-            } while ((ret == SQLITE_ROW) && (!isReasonableMatch(matchEnglish, matchPinyin, matchTonelessPinyin, targetPinyin)));
-
-            sqlite3_reset(stmt);
-            //int nMilliseconds = myTimer.elapsed();
-            //qDebug() << "took " << (float)(nMilliseconds)/1000 << "secs";
+            }
         }
 
         //this would only occur for very rare situation where the character didn't exist on its own in the db
         //e.g. fake characters like "Ｕ" in "ＵＳＢ手指"
         if (simplified.isEmpty()) simplified = currentChar;
-        matchEnglish.replace("\"", "\\\"");
-        if (actualHanziIndex > 0) componentsJson +=",";
-        componentsJson += "{ ";
-        componentsJson += "\"traditional\": \"" + currentChar + "\", ";
-        componentsJson += "\"simplified\": \"" + simplified + "\", ";
-        componentsJson += "\"pinyin\": \"" + targetPinyin + "\", ";
-        componentsJson += "\"toneNums\": \"" + targetToneNum + "\", ";
-        componentsJson += "\"english\": \"" + matchEnglish + "\"";
-        componentsJson += "}";
+        QVariantMap component;
+        component.insert("traditional", currentChar);
+        component.insert("simplified", simplified);
+        component.insert("pinyin", targetPinyin);
+        component.insert("toneNums", targetToneNum);
+        component.insert("english", matchEnglish);
+        components.append(component);
 
         actualHanziIndex++;
     }
-    componentsJson += "]";
-    //qDebug() << "componentsJson:" << componentsJson;
-    emit componentCharactersChanged(componentsJson);
-
+    //qDebug() << "components:" << components;
+    return components;
 }
 
 void DictDb::onRequestDetailsAsync(int wordsKey)
 {
     //qDebug() << "looking for " << wordsKey;
 
+    //the user is waiting for this one, so stop guessing
+    cancelPrefetch();
+
+    DetailsPayload details;
+    if (!requestDetails(wordsKey, details)) return;
+
+    //one reply, so the page updates once
+    emit detailsReady(wordsKey, details.toVariantMap());
+}
+
+//queues the top results to have their details worked out ahead of a tap,
+//once the results have been showing for PREFETCH_DELAY_MS
+void DictDb::startPrefetch(const QObjectList* results)
+{
+    int i;
+    for (i=0; (i < results->count()) && (i < PREFETCH_RESULT_COUNT); i++) {
+        int wordsKey = static_cast<SearchResult*>(results->at(i))->wordsKey();
+        if (!m_detailsCache->contains(wordsKey)) m_prefetchQueue.append(wordsKey);
+    }
+    if (!m_prefetchQueue.isEmpty()) m_prefetchTimer->start(PREFETCH_DELAY_MS);
+}
+
+void DictDb::cancelPrefetch()
+{
+    m_prefetchTimer->stop();
+    m_prefetchQueue.clear();
+}
+
+//one word per timeout, so a new search or a tap waiting in
+//the event queue is only ever held up by a single lookup
+void DictDb::onPrefetchTimeout()
+{
+    if (m_prefetchQueue.isEmpty()) return;
+    int wordsKey = m_prefetchQueue.takeFirst();
+    if (!m_detailsCache->contains(wordsKey)) {
+        //cached by requestDetails()
+        DetailsPayload details;
+        requestDetails(wordsKey, details);
+    }
+    if (!m_prefetchQueue.isEmpty()) m_prefetchTimer->start(0);
+}
+
+bool DictDb::requestDetails(int wordsKey, DetailsPayload& details, int parts)
+{
+    if (m_detailsCache->find(wordsKey, details)) return true;
+
     sqlite3_stmt* stmt = m_wordsKeyQueryStmt;
     sqlite3_bind_int(stmt, 1, wordsKey);
     int ret = sqlite3_step(stmt);
     if (ret != SQLITE_ROW) {
-        qDebug() << "onRequestDetailsAsync error, got " << ret;
-        return;
+        qCWarning(lcDetails) << "requestDetails error, got " << ret;
+        sqlite3_reset(stmt);
+        return false;
     }
     //qDebug() << " got " << ret;
     QString traditional = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 1));
@@ -619,14 +956,21 @@ void DictDb::onRequestDetailsAsync(int wordsKey)
 
     //qDebug() << "classifiers:" << classifiers;
 
-    sendExtraInfo(wordsKey,
-                  english,
-                  alsoWritten,
-                  alsoPronounced);
-
-    sendClassifiers(classifiers);
-    sendComponentCharacters(traditional, componentPinyin, toneNums);
-}
+    if (parts & ExtraInfoPart) {
+        details.extraInfo = extraInfoPayload(wordsKey,
+                                             english,
+                                             alsoWritten,
+                                             alsoPronounced);
+    }
 
+    if (parts & ClassifiersPart) details.classifiers = classifiersPayload(classifiers);
+    if (parts & ComponentsPart) details.components = componentCharactersPayload(traditional, componentPinyin, toneNums);
 
+    if (parts == AllDetailsParts) m_detailsCache->insert(wordsKey, details);
+    return true;
+}
 
+void DictDb::onFuzzyPinyinChanged(bool enabled)
+{
+    m_fuzzyPinyinEnabled = enabled;
+}
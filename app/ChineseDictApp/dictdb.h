@@ -18,12 +18,21 @@
 #ifndef DICTDB_H
 #define DICTDB_H
 
+#include <QHash>
+#include <QList>
 #include <QObject>
 #include <QThread>
+#include <QVariant>
+#include <QVector>
 
 #include "qobjectlistmodel.h"
+#include "detailscache.h"
+#include "englishsearch.h"
+#include "headwordindex.h"
+#include "textutils.h"
 #include "sqlite3.h"
 
+class QTimer;
 
 class SearchResult : public QObject
 {
@@ -70,6 +79,18 @@ public:
     QString toneNums() { return m_toneNums; }
     QString english() { return m_english; }
 
+    //the same fields as maps, for the json front ends
+    QVariantMap toVariantMap() const
+    {
+        QVariantMap map;
+        map.insert("wordsKey", m_wordsKey);
+        map.insert("traditional", m_traditional);
+        map.insert("simplified", m_simplified);
+        map.insert("pinyin", m_pinyin);
+        map.insert("toneNums", m_toneNums);
+        map.insert("english", m_english);
+        return map;
+    }
 
 };
 
@@ -82,10 +103,13 @@ public:
 private:
     sqlite3* db;
 
-    sqlite3_stmt* m_englishQueryStmt;
-    sqlite3_stmt* m_englishShortQueryStmt;
     sqlite3_stmt* m_pinyinQueryStmt;
     sqlite3_stmt* m_tonelessPinyinQueryStmt;
+    sqlite3_stmt* m_fuzzyPinyinQueryStmt;
+    sqlite3_stmt* m_initialsPinyinQueryStmt;
+    sqlite3_stmt* m_syllablePinyinQueryStmt;
+    sqlite3_stmt* m_mixedQueryStmt;
+    sqlite3_stmt* m_hanziReadingsQueryStmt;
     sqlite3_stmt* m_simplifiedQueryStmt;
     sqlite3_stmt* m_traditionalQueryStmt;
     sqlite3_stmt* m_wordsKeyQueryStmt;
@@ -95,11 +119,35 @@ private:
 
     sqlite3_stmt* m_allWordsQueryStmt;
 
+    EnglishSearch* m_englishSearch;
+    HeadwordIndex m_headwordIndex;
+
     QThread m_thread;
 
+    //details worked out before they are asked for, see startPrefetch()
+    QTimer* m_prefetchTimer;
+    QList<int> m_prefetchQueue;
+
+    //m_ownDetailsCache, unless one is shared with setDetailsCache()
+    DetailsCache* m_detailsCache;
+    DetailsCache m_ownDetailsCache;
+
+    bool m_fuzzyPinyinEnabled;
+
+    //buffers for the pinyin queries of matchChinese(),
+    //kept between searches for their capacity
+    PinyinSearchQueries m_pinyinQueries;
+    QByteArray m_queryUtf8;
+    QVector<int> m_resultRowids;
+
  private:
-    bool openDb();
+    void init(const QString& dbPath);
+#ifdef Q_OS_ANDROID
+    void copyDbFromAssets();
+#endif
+    bool openDb(const QString& filePath);
     void makeStatements();
+    void loadHeadwordIndex();
     bool addWord(sqlite3_stmt *insertStmt,
             QString traditional,
             QString simplified,
@@ -110,19 +158,28 @@ private:
             QString classifier,
             QString alsoWrittenAs);
 
-    void sendExtraInfo
-        (int wordsKey,
-         const QString& rawEnglish,
-         const QString& alsoWritten,
-         const QString& alsoPronounced);
-
-    void sendClassifiers(const QString &classifiers);
+    QString makeMixedQuery(const QStringList& positions);
+    void bindQuery(sqlite3_stmt* stmt, const QString& query);
+    void appendNewResultRows(QObjectList* results, sqlite3_stmt* stmt);
+    void appendWordsKeyRows(QObjectList* results, const QList<int>& wordsKeys);
 
     void prepareStatement(QString& query, sqlite3_stmt **stmt);
 
+    void startPrefetch(const QObjectList* results);
+    void cancelPrefetch();
+
 public:
 
+    //which parts requestDetails() fills in
+    enum DetailsPart {
+        ExtraInfoPart = 1,
+        ClassifiersPart = 2,
+        ComponentsPart = 4,
+        AllDetailsParts = 7
+    };
+
     explicit DictDb();
+    explicit DictDb(const QString& dbPath);
 
     explicit DictDb(QObject *parent) :
         QObject(parent)
@@ -133,10 +190,14 @@ public:
         m_thread.quit();
         m_thread.wait();
 
-        sqlite3_finalize(m_englishQueryStmt);
-        sqlite3_finalize(m_englishShortQueryStmt);
+        delete m_englishSearch;
         sqlite3_finalize(m_pinyinQueryStmt);
         sqlite3_finalize(m_tonelessPinyinQueryStmt);
+        sqlite3_finalize(m_fuzzyPinyinQueryStmt);
+        sqlite3_finalize(m_initialsPinyinQueryStmt);
+        sqlite3_finalize(m_syllablePinyinQueryStmt);
+        sqlite3_finalize(m_mixedQueryStmt);
+        sqlite3_finalize(m_hanziReadingsQueryStmt);
         sqlite3_finalize(m_simplifiedQueryStmt);
         sqlite3_finalize(m_traditionalQueryStmt);
         sqlite3_finalize(m_wordsKeyQueryStmt);
@@ -149,13 +210,37 @@ public:
 
     void start();
 
+    static QString dbFilePath();
+
+    //synchronous versions of the slots below, for front ends without the UI
+    //(e.g. the cli and server). the caller owns the returned results
+    QObjectList* matchChinese(const QString& search);
+    QObjectList* matchEnglish(const QString& search);
+    //whole payloads (all parts) are cached, and a cached one serves any parts
+    bool requestDetails(int wordsKey, DetailsPayload& details, int parts = AllDetailsParts);
+
+    //e.g. one cache for every DictDb in a server's pool. not owned
+    void setDetailsCache(DetailsCache* cache) { m_detailsCache = cache; }
+    DetailsCache* detailsCache() const { return m_detailsCache; }
+
+    //a list of search results, one map each, as the cli and server send them
+    static QVariantList resultsPayload(const QObjectList* results);
+
+    //what is sent to QML for each part of the details page
+    static QVariantMap extraInfoPayload
+        (int wordsKey,
+         const QString& rawEnglish,
+         const QString& alsoWritten,
+         const QString& alsoPronounced);
+    QVariantList classifiersPayload(const QString& classifiers);
+    QVariantList componentCharactersPayload(const QString& characters, const QString& pinyin, const QString& toneNums);
+
 signals:
 
     //used to connect to QML in UI thread
     void searchInProgressChanged(QVariant inProgress);
-    void extraInfoChanged(QVariant english);
-    void classifiersChanged(QVariant english);
-    void componentCharactersChanged(QVariant components);
+    //the whole details page for wordsKey, from DetailsPayload::toVariantMap()
+    void detailsReady(QVariant wordsKey, QVariant details);
 
     //used to connect to resultsModel in UI thread
     void clearAndDeleteResultList();
@@ -166,9 +251,12 @@ public slots:
 
     void onMatchEnglishAsync(const QString& search);
     void onMatchChineseAsync(const QString& search);
-    void sendComponentCharacters(const QString& characters, const QString &pinyin, const QString &toneNums);
 
     void onRequestDetailsAsync(int wordsKey);
+    void onFuzzyPinyinChanged(bool enabled);
+
+private slots:
+    void onPrefetchTimeout();
 };
 
 //QML_DECLARE_TYPE(DictDb)
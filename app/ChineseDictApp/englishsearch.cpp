@@ -0,0 +1,365 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <QDebug>
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+#include <algorithm>
+#include <math.h>
+
+#include <assert.h>
+#include "englishsearch.h"
+#include "logging.h"
+#include "textutils.h"
+
+//standard BM25 parameters
+#define BM25_K1 1.2
+#define BM25_B 0.75
+
+//bonus when a definition is just the term, e.g. "to run" for "run"
+#define EXACT_GLOSS_BONUS 3.0
+//bonus for the term appearing in the first definition, falling off for later ones
+#define FIRST_DEF_BONUS 2.0
+//how much a common word (low word_rank) is preferred over a rare one
+#define WORD_RANK_WEIGHT 0.3
+//share of a term's score earned by matching its stem, the rest needs the exact form
+#define STEM_MATCH_WEIGHT 0.7
+//share of a term's score earned when only a longer word starting with it matches
+#define PREFIX_MATCH_WEIGHT 0.5
+//how many completions of a partly typed word are tried alongside the other terms
+#define MAX_PREFIX_COMPLETIONS 64
+//a single partly typed word has its own postings read only if it is in
+//at most this many entries, commoner words like "a" and "the" are served
+//from english_prefixes alone
+#define MAX_PARTIAL_WORD_DOCS 1000
+
+struct EnglishCandidate {
+    double score;
+    int matchedTerms;
+    int wordRank;
+    int wordsKey;
+};
+
+static bool isBetterCandidate(const EnglishCandidate& a, const EnglishCandidate& b)
+{
+    if (a.score != b.score) return a.score > b.score;
+    return a.wordRank < b.wordRank;
+}
+
+EnglishSearch::EnglishSearch(sqlite3* db) :
+    m_db(db),
+    m_docCount(0),
+    m_averageDocLength(1.0)
+{
+    prepareStatement("SELECT doc_count FROM english_stem_terms WHERE stem = ?",
+                     &m_stemDocCountStmt);
+    prepareStatement("SELECT words_key, term_freq, def_index, exact_gloss, doc_length, word_rank "
+                     "FROM english_stem_postings WHERE stem = ?",
+                     &m_stemPostingsStmt);
+    prepareStatement("SELECT words_key, term_freq, def_index, exact_gloss, doc_length, word_rank "
+                     "FROM english_postings WHERE term = ?",
+                     &m_termPostingsStmt);
+    prepareStatement("SELECT words_key, term_freq, def_index, exact_gloss, doc_length, word_rank "
+                     "FROM english_stem_postings WHERE stem = ? AND words_key = ?",
+                     &m_stemPostingStmt);
+    prepareStatement("SELECT words_key, term_freq, def_index, exact_gloss, doc_length, word_rank "
+                     "FROM english_postings WHERE term = ? AND words_key = ?",
+                     &m_termPostingStmt);
+    prepareStatement("SELECT term, doc_count FROM english_terms WHERE term > ? AND term < ? "
+                     "ORDER BY doc_count DESC LIMIT " + QString::number(MAX_PREFIX_COMPLETIONS),
+                     &m_completionsStmt);
+    prepareStatement("SELECT words_keys FROM english_prefixes WHERE prefix = ?",
+                     &m_prefixTopStmt);
+
+    sqlite3_stmt* stmt;
+    prepareStatement("SELECT doc_count, average_doc_length FROM english_stats", &stmt);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        m_docCount = sqlite3_column_int(stmt, 0);
+        m_averageDocLength = sqlite3_column_double(stmt, 1);
+    } else {
+        qCDebug(lcSearch) << "EnglishSearch: no english_stats in db";
+    }
+    sqlite3_finalize(stmt);
+    if (m_averageDocLength <= 0) m_averageDocLength = 1.0;
+}
+
+EnglishSearch::~EnglishSearch()
+{
+    sqlite3_finalize(m_stemDocCountStmt);
+    sqlite3_finalize(m_stemPostingsStmt);
+    sqlite3_finalize(m_termPostingsStmt);
+    sqlite3_finalize(m_stemPostingStmt);
+    sqlite3_finalize(m_termPostingStmt);
+    sqlite3_finalize(m_completionsStmt);
+    sqlite3_finalize(m_prefixTopStmt);
+}
+
+void EnglishSearch::prepareStatement(const QString& query, sqlite3_stmt** stmt)
+{
+    QByteArray queryUtf8 = query.toUtf8();
+    int ret = sqlite3_prepare_v2(m_db,
+        queryUtf8.constData(),
+        queryUtf8.size(),
+        stmt,
+        NULL);
+
+    if (ret != SQLITE_OK) {
+        qCWarning(lcSearch) << "Error preparing statement <" << query << "> ";
+        qCWarning(lcSearch) << "error: " << sqlite3_errmsg(m_db);
+      assert(false);
+    }
+    assert(stmt);
+}
+
+//BM25 for the posting in the current row of stmt, plus its field position bonuses
+double EnglishSearch::postingScore(sqlite3_stmt* stmt, double termIdf)
+{
+    int termFreq = sqlite3_column_int(stmt, 1);
+    int defIndex = sqlite3_column_int(stmt, 2);
+    bool exactGloss = sqlite3_column_int(stmt, 3);
+    int docLength = sqlite3_column_int(stmt, 4);
+
+    double lengthNorm = 1.0 - BM25_B + BM25_B * docLength / m_averageDocLength;
+    double score = termIdf * (termFreq * (BM25_K1 + 1.0)) / (termFreq + BM25_K1 * lengthNorm);
+    score += FIRST_DEF_BONUS / (1 + defIndex);
+    if (exactGloss) score += EXACT_GLOSS_BONUS;
+    return score;
+}
+
+//adds every posting in stmt to the candidates that have matched the terms
+//before termIndex. the first term creates the candidates, after that
+//a candidate that missed an earlier term is never revived.
+//calling again for the same termIndex only adds to the score
+void EnglishSearch::addPostings(sqlite3_stmt* stmt, double termIdf, double weight, int termIndex,
+                                QHash<int, EnglishCandidate>& candidates)
+{
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int wordsKey = sqlite3_column_int(stmt, 0);
+        QHash<int, EnglishCandidate>::iterator it = candidates.find(wordsKey);
+        if (it == candidates.end()) {
+            if (termIndex > 0) continue;
+            int wordRank = sqlite3_column_int(stmt, 5);
+            EnglishCandidate newCandidate = { -WORD_RANK_WEIGHT * log((double)qMax(wordRank, 1)), 0, wordRank, wordsKey };
+            it = candidates.insert(wordsKey, newCandidate);
+        }
+        EnglishCandidate& candidate = it.value();
+        if (candidate.matchedTerms < termIndex) continue;
+        if (candidate.matchedTerms == termIndex) candidate.matchedTerms++;
+        candidate.score += weight * postingScore(stmt, termIdf);
+    }
+    sqlite3_reset(stmt);
+}
+
+//the same as addPostings(), but looks up the posting of each candidate
+//that has matched at least minMatchedTerms terms by the primary key,
+//rather than reading every posting for key
+void EnglishSearch::probePostings(sqlite3_stmt* stmt, const QByteArray& key, double termIdf, double weight,
+                                  int termIndex, int minMatchedTerms, QHash<int, EnglishCandidate>& candidates)
+{
+    sqlite3_bind_text(stmt, 1, key.constData(), key.size(), SQLITE_TRANSIENT);
+    QHash<int, EnglishCandidate>::iterator it;
+    for (it = candidates.begin(); it != candidates.end(); ++it) {
+        EnglishCandidate& candidate = it.value();
+        if (candidate.matchedTerms < minMatchedTerms) continue;
+        sqlite3_bind_int(stmt, 2, candidate.wordsKey);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            if (candidate.matchedTerms == termIndex) candidate.matchedTerms++;
+            candidate.score += weight * postingScore(stmt, termIdf);
+        }
+        sqlite3_reset(stmt);
+    }
+}
+
+static int countCandidates(const QHash<int, EnglishCandidate>& candidates, int minMatchedTerms)
+{
+    int count = 0;
+    QHash<int, EnglishCandidate>::const_iterator it;
+    for (it = candidates.constBegin(); it != candidates.constEnd(); ++it) {
+        if (it.value().matchedTerms >= minMatchedTerms) count++;
+    }
+    return count;
+}
+
+//adds the postings for key from listStmt, unless there are already
+//candidates and fewer of them than listLength, the number of postings
+//(or a bound on it), in which case each one is looked up with probeStmt
+void EnglishSearch::addKeyPostings(sqlite3_stmt* listStmt, sqlite3_stmt* probeStmt, const QByteArray& key,
+                                   int listLength, double termIdf, double weight, int termIndex,
+                                   int minMatchedTerms, QHash<int, EnglishCandidate>& candidates)
+{
+    if ((termIndex > 0) || (minMatchedTerms > 0)) {
+        if (countCandidates(candidates, minMatchedTerms) < listLength) {
+            probePostings(probeStmt, key, termIdf, weight, termIndex, minMatchedTerms, candidates);
+            return;
+        }
+    }
+    sqlite3_bind_text(listStmt, 1, key.constData(), key.size(), SQLITE_TRANSIENT);
+    addPostings(listStmt, termIdf, weight, termIndex, candidates);
+}
+
+double EnglishSearch::idf(int docCount)
+{
+    return log(1.0 + (m_docCount - docCount + 0.5) / (docCount + 0.5));
+}
+
+int EnglishSearch::stemDocCount(const QString& term)
+{
+    sqlite3_bind_text(m_stemDocCountStmt, 1, stemEnglish(term).toUtf8(), -1, SQLITE_TRANSIENT);
+    int docCount = 0;
+    if (sqlite3_step(m_stemDocCountStmt) == SQLITE_ROW) {
+        docCount = sqlite3_column_int(m_stemDocCountStmt, 0);
+    }
+    sqlite3_reset(m_stemDocCountStmt);
+    return docCount;
+}
+
+//matches term by its stem, then tops up the score of those that
+//also have the exact form. docCount, the entries using the stem, is
+//also a bound on the entries using the exact form
+void EnglishSearch::addTerm(const QString& term, int docCount, int termIndex,
+                            QHash<int, EnglishCandidate>& candidates)
+{
+    double termIdf = idf(docCount);
+    addKeyPostings(m_stemPostingsStmt, m_stemPostingStmt, stemEnglish(term).toUtf8(), docCount,
+                   termIdf, STEM_MATCH_WEIGHT, termIndex, termIndex, candidates);
+    //only those that matched the stem can have the exact form
+    addKeyPostings(m_termPostingsStmt, m_termPostingStmt, term.toUtf8(), docCount,
+                   termIdf, 1.0 - STEM_MATCH_WEIGHT, termIndex, termIndex + 1, candidates);
+}
+
+//matches a partly typed word against the most common terms it could become.
+//the range scan works because english_terms is ordered by term
+void EnglishSearch::addPrefix(const QString& prefix, int termIndex,
+                              QHash<int, EnglishCandidate>& candidates)
+{
+    int docCount = stemDocCount(prefix);
+    if (docCount > 0) addTerm(prefix, docCount, termIndex, candidates);
+
+    QString upper = prefix;
+    upper[upper.length()-1] = QChar(upper.at(upper.length()-1).unicode() + 1);
+    sqlite3_bind_text(m_completionsStmt, 1, prefix.toUtf8(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(m_completionsStmt, 2, upper.toUtf8(), -1, SQLITE_TRANSIENT);
+    QList<QPair<QString, int> > completions;
+    while (sqlite3_step(m_completionsStmt) == SQLITE_ROW) {
+        completions.append(qMakePair(
+            QString::fromUtf8((const char*)sqlite3_column_text(m_completionsStmt, 0)),
+            sqlite3_column_int(m_completionsStmt, 1)));
+    }
+    sqlite3_reset(m_completionsStmt);
+
+    int i;
+    for (i=0; i < completions.count(); i++) {
+        addKeyPostings(m_termPostingsStmt, m_termPostingStmt, completions[i].first.toUtf8(),
+                       completions[i].second, idf(completions[i].second), PREFIX_MATCH_WEIGHT,
+                       termIndex, termIndex, candidates);
+    }
+}
+
+//the best entries for the words starting with prefix, worked out by dbcreator
+QList<int> EnglishSearch::prefixTopMatches(const QString& prefix)
+{
+    QList<int> result;
+    sqlite3_bind_text(m_prefixTopStmt, 1, prefix.toUtf8(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(m_prefixTopStmt) == SQLITE_ROW) {
+        QString wordsKeys = QString::fromUtf8((const char*)sqlite3_column_text(m_prefixTopStmt, 0));
+        QStringList keys = wordsKeys.split(",", QString::SkipEmptyParts);
+        int i;
+        for (i=0; i < keys.count(); i++) {
+            result.append(keys[i].toInt());
+        }
+    }
+    sqlite3_reset(m_prefixTopStmt);
+    return result;
+}
+
+QList<int> EnglishSearch::match(const QString& search, int limit)
+{
+    QList<int> result;
+    QStringList terms = tokenizeEnglish(search);
+    if (terms.isEmpty()) return result;
+
+    //the last word is still being typed unless something follows it
+    QString prefix;
+    if (search.at(search.length()-1).isLetterOrNumber()) {
+        prefix = terms.takeLast();
+    }
+    terms.removeDuplicates();
+
+    //find how many entries use each stem, rarest first, so that the first
+    //term gives the smallest candidate set and the later terms only have
+    //to look up the postings of those candidates
+    QList<QPair<int, QString> > termsByDocCount;
+    int i;
+    for (i=0; i < terms.count(); i++) {
+        int docCount = stemDocCount(terms[i]);
+        if (docCount == 0) return result; //every term has to match
+        termsByDocCount.append(qMakePair(docCount, terms[i]));
+    }
+    std::sort(termsByDocCount.begin(), termsByDocCount.end());
+
+    QHash<int, EnglishCandidate> candidates;
+    for (i=0; i < termsByDocCount.count(); i++) {
+        addTerm(termsByDocCount[i].second, termsByDocCount[i].first, i, candidates);
+    }
+
+    int matchedTerms = terms.count();
+    if (!prefix.isEmpty()) {
+        if (terms.isEmpty()) {
+            //a single partly typed word could become thousands of words,
+            //so take entries for the word as typed if it is not too common,
+            //then the precomputed best entries for its completions
+            int docCount = stemDocCount(prefix);
+            if ((docCount > 0) && (docCount <= MAX_PARTIAL_WORD_DOCS)) {
+                addTerm(prefix, docCount, 0, candidates);
+            }
+            result = bestCandidates(candidates, 1, limit);
+
+            QList<int> top = prefixTopMatches(prefix);
+            for (i=0; (i < top.count()) && (result.count() < limit); i++) {
+                if (!candidates.contains(top[i])) result.append(top[i]);
+            }
+            return result;
+        }
+        addPrefix(prefix, matchedTerms, candidates);
+        matchedTerms++;
+    }
+
+    return bestCandidates(candidates, matchedTerms, limit);
+}
+
+//the words keys of the highest scoring candidates that matched every term
+QList<int> EnglishSearch::bestCandidates(const QHash<int, EnglishCandidate>& candidates,
+                                         int matchedTerms, int limit)
+{
+    QVector<EnglishCandidate> matches;
+    QHashIterator<int, EnglishCandidate> iterator(candidates);
+    while (iterator.hasNext()) {
+        iterator.next();
+        if (iterator.value().matchedTerms == matchedTerms) matches.append(iterator.value());
+    }
+
+    QList<int> result;
+    int count = qMin(limit, matches.count());
+    std::partial_sort(matches.begin(), matches.begin() + count, matches.end(), isBetterCandidate);
+    int i;
+    for (i=0; i < count; i++) {
+        result.append(matches[i].wordsKey);
+    }
+    return result;
+}
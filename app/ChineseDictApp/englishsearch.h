@@ -0,0 +1,80 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef ENGLISHSEARCH_H
+#define ENGLISHSEARCH_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include "sqlite3.h"
+
+struct EnglishCandidate;
+
+//ranks english matches using the english postings tables written by dbcreator.
+//each posting already holds its term frequency, definition position and
+//gloss flag, so scoring never needs to look at the english text itself.
+//terms are matched by stem, with a bonus when the exact form also matches.
+//a partly typed last word is matched against its completions
+class EnglishSearch
+{
+private:
+    sqlite3* m_db;
+
+    sqlite3_stmt* m_stemDocCountStmt;
+    sqlite3_stmt* m_stemPostingsStmt;
+    sqlite3_stmt* m_termPostingsStmt;
+    sqlite3_stmt* m_stemPostingStmt;
+    sqlite3_stmt* m_termPostingStmt;
+    sqlite3_stmt* m_completionsStmt;
+    sqlite3_stmt* m_prefixTopStmt;
+
+    int m_docCount;
+    double m_averageDocLength;
+
+    void prepareStatement(const QString& query, sqlite3_stmt** stmt);
+    double postingScore(sqlite3_stmt* stmt, double termIdf);
+    double idf(int docCount);
+    int stemDocCount(const QString& term);
+    void addPostings(sqlite3_stmt* stmt, double termIdf, double weight, int termIndex,
+                     QHash<int, EnglishCandidate>& candidates);
+    void probePostings(sqlite3_stmt* stmt, const QByteArray& key, double termIdf, double weight,
+                       int termIndex, int minMatchedTerms, QHash<int, EnglishCandidate>& candidates);
+    void addKeyPostings(sqlite3_stmt* listStmt, sqlite3_stmt* probeStmt, const QByteArray& key,
+                        int listLength, double termIdf, double weight, int termIndex,
+                        int minMatchedTerms, QHash<int, EnglishCandidate>& candidates);
+    void addTerm(const QString& term, int docCount, int termIndex,
+                 QHash<int, EnglishCandidate>& candidates);
+    void addPrefix(const QString& prefix, int termIndex,
+                   QHash<int, EnglishCandidate>& candidates);
+    QList<int> prefixTopMatches(const QString& prefix);
+    QList<int> bestCandidates(const QHash<int, EnglishCandidate>& candidates,
+                              int matchedTerms, int limit);
+
+public:
+    explicit EnglishSearch(sqlite3* db);
+    ~EnglishSearch();
+
+    //returns the words keys of entries containing every term of search
+    //(or another form of it), best match first. unless search ends in a space
+    //or punctuation its last word is treated as a prefix
+    QList<int> match(const QString& search, int limit);
+};
+
+#endif // ENGLISHSEARCH_H
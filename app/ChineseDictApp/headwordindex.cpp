@@ -0,0 +1,270 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <QDataStream>
+#include <QDebug>
+#include <QRegExp>
+#include <QStringList>
+#include <algorithm>
+
+#include "headwordindex.h"
+#include "logging.h"
+
+//ends every headword, it sorts before any character a headword can contain
+#define HEADWORD_END QChar('\n')
+
+//bumped whenever the serialized layout changes
+#define HEADWORD_INDEX_VERSION 1
+
+//orders suffixes of the text, each one stopping at the end of its headword
+class SuffixLess
+{
+private:
+    const QChar* m_text;
+
+public:
+    explicit SuffixLess(const QChar* text) : m_text(text) {}
+
+    bool operator()(qint32 a, qint32 b) const
+    {
+        const QChar* p = m_text + a;
+        const QChar* q = m_text + b;
+        while ((*p == *q) && (*p != HEADWORD_END)) {
+            p++;
+            q++;
+        }
+        return p->unicode() < q->unicode();
+    }
+};
+
+HeadwordIndex::HeadwordIndex()
+{
+}
+
+void HeadwordIndex::addEntry(int wordsKey, const QString& traditional, const QString& simplified)
+{
+    m_entryStarts.append(m_text.length());
+    m_wordsKeys.append(wordsKey);
+    m_text.append(traditional);
+    m_text.append(HEADWORD_END);
+    if (simplified != traditional) {
+        m_text.append(simplified);
+        m_text.append(HEADWORD_END);
+    }
+}
+
+void HeadwordIndex::build()
+{
+    m_suffixes.clear();
+    int i;
+    for (i=0; i < m_text.length(); i++) {
+        if (m_text.at(i) != HEADWORD_END) m_suffixes.append(i);
+    }
+    std::sort(m_suffixes.begin(), m_suffixes.end(), SuffixLess(m_text.constData()));
+    m_suffixes.squeeze();
+    m_entryStarts.squeeze();
+    m_wordsKeys.squeeze();
+}
+
+QByteArray HeadwordIndex::serialize() const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << (qint32)HEADWORD_INDEX_VERSION << m_text << m_suffixes << m_entryStarts << m_wordsKeys;
+    return data;
+}
+
+bool HeadwordIndex::deserialize(const QByteArray& data)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_0);
+    qint32 version = 0;
+    stream >> version;
+    if (version != HEADWORD_INDEX_VERSION) {
+        qCWarning(lcSearch) << "HeadwordIndex: unexpected version" << version;
+        return false;
+    }
+    stream >> m_text >> m_suffixes >> m_entryStarts >> m_wordsKeys;
+    if ((stream.status() != QDataStream::Ok) || (m_entryStarts.count() != m_wordsKeys.count())) {
+        qCWarning(lcSearch) << "HeadwordIndex: corrupt data";
+        m_text.clear();
+        m_suffixes.clear();
+        m_entryStarts.clear();
+        m_wordsKeys.clear();
+        return false;
+    }
+    return true;
+}
+
+//compares the suffix at position with pattern, as if the suffix were cut
+//to the length of pattern. negative if the suffix sorts first
+int HeadwordIndex::compareSuffix(int position, const QString& pattern) const
+{
+    const QChar* p = m_text.constData() + position;
+    int i;
+    for (i=0; i < pattern.length(); i++) {
+        //HEADWORD_END is smaller than anything in a pattern
+        if (p[i] != pattern.at(i)) return p[i].unicode() - pattern.at(i).unicode();
+    }
+    return 0;
+}
+
+//the number of the entry that position in the text belongs to
+int HeadwordIndex::entryAt(int position) const
+{
+    QVector<qint32>::const_iterator it =
+            std::upper_bound(m_entryStarts.constBegin(), m_entryStarts.constEnd(), position);
+    return (it - m_entryStarts.constBegin()) - 1;
+}
+
+//the block of m_suffixes, first to last exclusive, that start with pattern
+void HeadwordIndex::suffixRange(const QString& pattern, int& first, int& last) const
+{
+    int low = 0;
+    int high = m_suffixes.count();
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (compareSuffix(m_suffixes[middle], pattern) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    first = low;
+    high = m_suffixes.count();
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (compareSuffix(m_suffixes[middle], pattern) <= 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    last = low;
+}
+
+//entries are numbered in word_rank order, so sorting the
+//entry numbers ranks them. an entry can be found more than once
+QList<int> HeadwordIndex::rankedWordsKeys(QVector<int>& entries, int limit) const
+{
+    QList<int> result;
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    int i;
+    for (i=0; (i < entries.count()) && (i < limit); i++) {
+        result.append(m_wordsKeys[entries[i]]);
+    }
+    return result;
+}
+
+QList<int> HeadwordIndex::find(const QString& pattern, int limit) const
+{
+    if (pattern.isEmpty() || pattern.contains(HEADWORD_END)) return QList<int>();
+
+    int first, last;
+    suffixRange(pattern, first, last);
+
+    QVector<int> entries;
+    entries.reserve(last - first);
+    int i;
+    for (i=first; i < last; i++) {
+        entries.append(entryAt(m_suffixes[i]));
+    }
+    return rankedWordsKeys(entries, limit);
+}
+
+//true if all of text matches pattern, with '?' for any one character
+//and '*' for any run of them (including none)
+static bool matchesWildcards(const QChar* text, int length, const QString& pattern)
+{
+    int t = 0;
+    int p = 0;
+    int starPattern = -1;
+    int starText = 0;
+    while (t < length) {
+        if ((p < pattern.length()) && ((pattern.at(p) == '?') || (pattern.at(p) == text[t]))) {
+            t++;
+            p++;
+        } else if ((p < pattern.length()) && (pattern.at(p) == '*')) {
+            starPattern = p++;
+            starText = t;
+        } else if (starPattern >= 0) {
+            //let the last '*' swallow one more character
+            p = starPattern + 1;
+            t = ++starText;
+        } else {
+            return false;
+        }
+    }
+    while ((p < pattern.length()) && (pattern.at(p) == '*')) p++;
+    return p == pattern.length();
+}
+
+QList<int> HeadwordIndex::findPattern(const QString& pattern, int limit) const
+{
+    if (pattern.isEmpty() || pattern.contains(HEADWORD_END)) return QList<int>();
+
+    //use the fixed part with the fewest occurrences to find candidates
+    QStringList fixedParts = pattern.split(QRegExp("[?*]"), QString::SkipEmptyParts);
+    int bestFirst = 0;
+    int bestLast = -1;
+    int i;
+    for (i=0; i < fixedParts.count(); i++) {
+        int first, last;
+        suffixRange(fixedParts[i], first, last);
+        if ((bestLast < 0) || (last - first < bestLast - bestFirst)) {
+            bestFirst = first;
+            bestLast = last;
+        }
+    }
+
+    QVector<int> entries;
+    const QChar* text = m_text.constData();
+    if (bestLast >= 0) {
+        //check the whole headword around each occurrence
+        for (i=bestFirst; i < bestLast; i++) {
+            int start = m_suffixes[i];
+            while ((start > 0) && (text[start-1] != HEADWORD_END)) start--;
+            int end = m_suffixes[i];
+            while (text[end] != HEADWORD_END) end++;
+            if (matchesWildcards(text + start, end - start, pattern)) {
+                entries.append(entryAt(start));
+            }
+        }
+    } else {
+        //nothing but wildcards, so only the length matters.
+        //check every headword, which is one pass over m_text
+        int entry = 0;
+        int start = 0;
+        int end;
+        for (end=0; end < m_text.length(); end++) {
+            if (text[end] != HEADWORD_END) continue;
+            while ((entry + 1 < m_entryStarts.count()) && (m_entryStarts[entry + 1] <= start)) entry++;
+            if (matchesWildcards(text + start, end - start, pattern)) entries.append(entry);
+            start = end + 1;
+        }
+    }
+    return rankedWordsKeys(entries, limit);
+}
+
+int HeadwordIndex::byteSize() const
+{
+    return m_text.length() * sizeof(QChar) +
+           (m_suffixes.count() + m_entryStarts.count() + m_wordsKeys.count()) * sizeof(qint32);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef HEADWORDINDEX_H
+#define HEADWORDINDEX_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+//finds every entry whose simplified or traditional headword contains
+//a string anywhere, not just at the start.
+//it is a suffix array over all the headwords joined together, built once
+//by dbcreator and loaded from the db as a single blob.
+//entries are added most common first, so the entry number is the ranking.
+//the same suffix array serves wildcard patterns: the positions of their
+//rarest fixed part are the candidates, each checked in place
+class HeadwordIndex
+{
+private:
+    //every headword, each followed by a '\n'. an entry whose simplified
+    //and traditional are the same only appears once
+    QString m_text;
+    //start of every suffix of m_text that begins with a headword character, in sorted order
+    QVector<qint32> m_suffixes;
+    //where each entry's headwords begin in m_text, ascending
+    QVector<qint32> m_entryStarts;
+    QVector<qint32> m_wordsKeys;
+
+    int compareSuffix(int position, const QString& pattern) const;
+    void suffixRange(const QString& pattern, int& first, int& last) const;
+    int entryAt(int position) const;
+    QList<int> rankedWordsKeys(QVector<int>& entries, int limit) const;
+
+public:
+    HeadwordIndex();
+
+    //entries must be added in word_rank order, then build() called
+    void addEntry(int wordsKey, const QString& traditional, const QString& simplified);
+    void build();
+
+    QByteArray serialize() const;
+    bool deserialize(const QByteArray& data);
+
+    //words keys of up to limit entries containing pattern, most common first
+    QList<int> find(const QString& pattern, int limit) const;
+
+    //words keys of up to limit entries whose whole headword matches pattern,
+    //where '?' is any one character and '*' any run of them, e.g. "一?不?"
+    QList<int> findPattern(const QString& pattern, int limit) const;
+
+    int entryCount() const { return m_entryStarts.count(); }
+    //approximate size in memory
+    int byteSize() const;
+};
+
+#endif // HEADWORDINDEX_H
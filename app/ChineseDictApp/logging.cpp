@@ -0,0 +1,23 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "logging.h"
+
+Q_LOGGING_CATEGORY(lcImport, "chinesedict.import")
+Q_LOGGING_CATEGORY(lcSearch, "chinesedict.search")
+Q_LOGGING_CATEGORY(lcDetails, "chinesedict.details")
+Q_LOGGING_CATEGORY(lcSettings, "chinesedict.settings")
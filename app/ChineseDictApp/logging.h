@@ -0,0 +1,34 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+
+//debug messages by area. use qCDebug(lcImport) etc. rather than qDebug():
+//the arguments are only formatted if the category is enabled, and release
+//builds define QT_NO_DEBUG_OUTPUT, which compiles the statements out.
+//in debug builds everything is on, and areas can be switched at runtime, e.g.
+//  QT_LOGGING_RULES="chinesedict.import.debug=false"
+//errors go to qCWarning(), which stays in release builds
+Q_DECLARE_LOGGING_CATEGORY(lcImport)     //reading cedict into the db
+Q_DECLARE_LOGGING_CATEGORY(lcSearch)     //running a search
+Q_DECLARE_LOGGING_CATEGORY(lcDetails)    //putting together the details page
+Q_DECLARE_LOGGING_CATEGORY(lcSettings)   //the settings db
+
+#endif // LOGGING_H
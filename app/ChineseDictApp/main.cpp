@@ -57,14 +57,8 @@ int main(int argc, char *argv[])
                      SLOT(onMatchEnglishAsync(QString)), Qt::QueuedConnection);
     QObject::connect(item, SIGNAL(requestDetailsAsync(int)), &dictDb,
                      SLOT(onRequestDetailsAsync(int)), Qt::QueuedConnection);
-    QObject::connect(&dictDb, SIGNAL(extraInfoChanged(QVariant)), item,
-                     SLOT(onExtraInfoChanged(QVariant)), Qt::QueuedConnection);
-    QObject::connect(&dictDb, SIGNAL(componentCharactersChanged(QVariant)), item,
-                     SLOT(onComponentCharactersChanged(QVariant)), Qt::QueuedConnection);
-
-
-    QObject::connect(&dictDb, SIGNAL(classifiersChanged(QVariant)), item,
-                     SLOT(onClassifiersChanged(QVariant)), Qt::QueuedConnection);
+    QObject::connect(&dictDb, SIGNAL(detailsReady(QVariant,QVariant)), item,
+                     SLOT(onDetailsReady(QVariant,QVariant)), Qt::QueuedConnection);
 
     QObject::connect(&dictDb, SIGNAL(searchInProgressChanged(QVariant)), item,
             SLOT(onSearchInProgressChanged(QVariant)), Qt::QueuedConnection);
@@ -75,6 +69,13 @@ int main(int argc, char *argv[])
             SLOT(onSetObjectListAsync(QObjectList*)), Qt::QueuedConnection);
 
 
+    //DictDb lives in its own thread, so hand it the flag rather than the Settings object
+    dictDb.onFuzzyPinyinChanged(settings.fuzzyPinyin());
+    QObject::connect(&settings, &Settings::fuzzyPinyinChanged, [&dictDb, &settings]() {
+        QMetaObject::invokeMethod(&dictDb, "onFuzzyPinyinChanged", Qt::QueuedConnection,
+                                  Q_ARG(bool, settings.fuzzyPinyin()));
+    });
+
     dictDb.start();
     return app.exec();
 }
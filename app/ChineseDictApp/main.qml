@@ -39,16 +39,11 @@ ApplicationWindow {
         searchPage.searchInProgress = inProgress;
     }
 
-    function onExtraInfoChanged(extraInfoJson) {
-        detailsPage.extraInfo = JSON.parse(extraInfoJson)
-    }
-
-    function onClassifiersChanged(classifiersJson) {
-        detailsPage.classifiers =  JSON.parse(classifiersJson)
-    }
-
-    function onComponentCharactersChanged(componentsJson) {
-        detailsPage.componentCharacters = JSON.parse(componentsJson)
+    //DictDb sends the whole details page at once, as a js object.
+    //a reply for a word that is no longer showing is dropped
+    function onDetailsReady(wordsKey, details) {
+        if (wordsKey !== detailsPage.wordsKey) return;
+        detailsPage.details = details
     }
 
 
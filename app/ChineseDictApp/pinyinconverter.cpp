@@ -0,0 +1,104 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTextCodec>
+#include <QTextDecoder>
+
+#include "pinyinconverter.h"
+
+PinyinConverter::PinyinConverter(const QString& dbPath) :
+    m_annotator(dbPath),
+    m_bytesConverted(0),
+    m_wordsConverted(0),
+    m_elapsedMs(0)
+{
+}
+
+QByteArray PinyinConverter::segmentJson(const AnnotatedSegment& segment)
+{
+    QJsonObject object;
+    object.insert("text", segment.text);
+    if (!segment.entries.isEmpty()) {
+        const LookupEntry& entry = segment.entries.first();
+        object.insert("pinyin", entry.pinyin);
+        QJsonArray tones;
+        QStringList toneNums = entry.toneNums.split(',', QString::SkipEmptyParts);
+        int i;
+        for (i=0; i < toneNums.count(); i++) {
+            tones.append(toneNums[i].toInt());
+        }
+        object.insert("tones", tones);
+    }
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+bool PinyinConverter::writeText(const QString& text, QIODevice* out)
+{
+    if (text.isEmpty()) return true;
+
+    QList<AnnotatedSegment> segments = m_annotator.annotate(text, true);
+    QByteArray output;
+    int i;
+    for (i=0; i < segments.count(); i++) {
+        output += segmentJson(segments[i]);
+        output += '\n';
+    }
+    m_wordsConverted += segments.count();
+    return out->write(output) == output.size();
+}
+
+bool PinyinConverter::convert(QIODevice* in, QIODevice* out, int chunkSize)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    //the decoder keeps any utf8 sequence split between chunks
+    QTextDecoder* decoder = QTextCodec::codecForName("UTF-8")->makeDecoder();
+    QString pending;
+    bool ok = true;
+    while (ok) {
+        QByteArray bytes = in->read(chunkSize);
+        if (bytes.isEmpty()) break;
+        m_bytesConverted += bytes.size();
+        pending += decoder->toUnicode(bytes);
+
+        //convert up to the last sentence end, keeping the rest for the next
+        //chunk in case it is part of a word. without one, don't hold on to
+        //more than a couple of chunks
+        int cut = pending.length();
+        while ((cut > 0) && !Segmenter::isSentenceEnd(pending.at(cut - 1))) cut--;
+        if ((cut == 0) && (pending.length() > chunkSize)) {
+            cut = pending.length();
+            if (pending.at(cut - 1).isHighSurrogate()) cut--;
+        }
+        if (cut > 0) {
+            ok = writeText(pending.left(cut), out);
+            pending.remove(0, cut);
+        }
+    }
+    if (ok) ok = writeText(pending, out);
+    delete decoder;
+
+    m_elapsedMs += timer.elapsed();
+    return ok;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef PINYINCONVERTER_H
+#define PINYINCONVERTER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+
+#include "textannotator.h"
+
+//how much utf8 input is read at a time
+#define PINYIN_CONVERTER_CHUNK_SIZE 65536
+
+//streams chinese text to pinyin, one word at a time, using the most common
+//reading of each dictionary word so that e.g. 行 in 银行 is háng.
+//the input is read in fixed size chunks and converted up to the last
+//sentence end in each, so memory stays bounded however long the input is
+class PinyinConverter
+{
+private:
+    TextAnnotator m_annotator;
+
+    qint64 m_bytesConverted;
+    qint64 m_wordsConverted;
+    qint64 m_elapsedMs;
+
+    bool writeText(const QString& text, QIODevice* out);
+
+public:
+    explicit PinyinConverter(const QString& dbPath);
+
+    bool isOpen() const { return m_annotator.isOpen(); }
+
+    //reads utf8 from in until it ends, writing a json line per word to out,
+    //e.g. {"text":"中国","pinyin":"zhōng guó","tones":[1,2]}.
+    //text not in the dictionary only has "text"
+    bool convert(QIODevice* in, QIODevice* out, int chunkSize = PINYIN_CONVERTER_CHUNK_SIZE);
+
+    //json for one annotated word, without a trailing newline
+    static QByteArray segmentJson(const AnnotatedSegment& segment);
+
+    //totals over every convert() so far, for reporting throughput
+    qint64 bytesConverted() const { return m_bytesConverted; }
+    qint64 wordsConverted() const { return m_wordsConverted; }
+    qint64 elapsedMs() const { return m_elapsedMs; }
+};
+
+#endif // PINYINCONVERTER_H
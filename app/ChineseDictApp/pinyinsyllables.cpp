@@ -0,0 +1,524 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "pinyinsyllables.h"
+
+//every toneless syllable, in alphabetical order, with ü spelt "v".
+//the interjections m, n, ng, hm and hng are left out, as with them
+//almost any run of letters could be split somehow
+static constexpr const char* s_syllables[] =
+{
+    "a", "ai", "an", "ang", "ao",
+    "ba", "bai", "ban", "bang", "bao", "bei", "ben", "beng", "bi", "bian", "biao", "bie", "bin", "bing", "bo", "bu",
+    "ca", "cai", "can", "cang", "cao", "ce", "cei", "cen", "ceng",
+    "cha", "chai", "chan", "chang", "chao", "che", "chen", "cheng", "chi", "chong", "chou",
+    "chu", "chua", "chuai", "chuan", "chuang", "chui", "chun", "chuo",
+    "ci", "cong", "cou", "cu", "cuan", "cui", "cun", "cuo",
+    "da", "dai", "dan", "dang", "dao", "de", "dei", "den", "deng", "di", "dia", "dian", "diao", "die", "ding", "diu",
+    "dong", "dou", "du", "duan", "dui", "dun", "duo",
+    "e", "ei", "en", "eng", "er",
+    "fa", "fan", "fang", "fei", "fen", "feng", "fo", "fou", "fu",
+    "ga", "gai", "gan", "gang", "gao", "ge", "gei", "gen", "geng", "gong", "gou",
+    "gu", "gua", "guai", "guan", "guang", "gui", "gun", "guo",
+    "ha", "hai", "han", "hang", "hao", "he", "hei", "hen", "heng", "hong", "hou",
+    "hu", "hua", "huai", "huan", "huang", "hui", "hun", "huo",
+    "ji", "jia", "jian", "jiang", "jiao", "jie", "jin", "jing", "jiong", "jiu", "ju", "juan", "jue", "jun",
+    "ka", "kai", "kan", "kang", "kao", "ke", "kei", "ken", "keng", "kong", "kou",
+    "ku", "kua", "kuai", "kuan", "kuang", "kui", "kun", "kuo",
+    "la", "lai", "lan", "lang", "lao", "le", "lei", "leng", "li", "lia", "lian", "liang", "liao", "lie", "lin", "ling", "liu",
+    "lo", "long", "lou", "lu", "luan", "lue", "lun", "luo", "lv", "lve",
+    "ma", "mai", "man", "mang", "mao", "me", "mei", "men", "meng", "mi", "mian", "miao", "mie", "min", "ming", "miu",
+    "mo", "mou", "mu",
+    "na", "nai", "nan", "nang", "nao", "ne", "nei", "nen", "neng", "ni", "nian", "niang", "niao", "nie", "nin", "ning", "niu",
+    "nong", "nou", "nu", "nuan", "nue", "nun", "nuo", "nv", "nve",
+    "o", "ou",
+    "pa", "pai", "pan", "pang", "pao", "pei", "pen", "peng", "pi", "pian", "piao", "pie", "pin", "ping", "po", "pou", "pu",
+    "qi", "qia", "qian", "qiang", "qiao", "qie", "qin", "qing", "qiong", "qiu", "qu", "quan", "que", "qun",
+    "ran", "rang", "rao", "re", "ren", "reng", "ri", "rong", "rou", "ru", "rua", "ruan", "rui", "run", "ruo",
+    "sa", "sai", "san", "sang", "sao", "se", "sen", "seng",
+    "sha", "shai", "shan", "shang", "shao", "she", "shei", "shen", "sheng", "shi", "shou",
+    "shu", "shua", "shuai", "shuan", "shuang", "shui", "shun", "shuo",
+    "si", "song", "sou", "su", "suan", "sui", "sun", "suo",
+    "ta", "tai", "tan", "tang", "tao", "te", "tei", "teng", "ti", "tian", "tiao", "tie", "ting",
+    "tong", "tou", "tu", "tuan", "tui", "tun", "tuo",
+    "wa", "wai", "wan", "wang", "wei", "wen", "weng", "wo", "wu",
+    "xi", "xia", "xian", "xiang", "xiao", "xie", "xin", "xing", "xiong", "xiu", "xu", "xuan", "xue", "xun",
+    "ya", "yan", "yang", "yao", "ye", "yi", "yin", "ying", "yo", "yong", "you", "yu", "yuan", "yue", "yun",
+    "za", "zai", "zan", "zang", "zao", "ze", "zei", "zen", "zeng",
+    "zha", "zhai", "zhan", "zhang", "zhao", "zhe", "zhei", "zhen", "zheng", "zhi", "zhong", "zhou",
+    "zhu", "zhua", "zhuai", "zhuan", "zhuang", "zhui", "zhun", "zhuo",
+    "zi", "zong", "zou", "zu", "zuan", "zui", "zun", "zuo"
+};
+
+#define SYLLABLE_COUNT ((int)(sizeof(s_syllables) / sizeof(s_syllables[0])))
+
+//the longest syllables, e.g. "zhuang", have six letters
+#define MAX_SYLLABLE_LETTERS 6
+
+static constexpr int stringLength(const char* s)
+{
+    int i = 0;
+    while (s[i] != 0) i++;
+    return i;
+}
+
+static constexpr int commonPrefixLength(const char* a, const char* b)
+{
+    int i = 0;
+    while ((a[i] != 0) && (a[i] == b[i])) i++;
+    return i;
+}
+
+static constexpr bool syllablesAreSorted()
+{
+    int i = 0;
+    for (i=1; i < SYLLABLE_COUNT; i++) {
+        int common = commonPrefixLength(s_syllables[i-1], s_syllables[i]);
+        if (s_syllables[i-1][common] >= s_syllables[i][common]) return false;
+    }
+    return true;
+}
+
+static_assert(syllablesAreSorted(), "s_syllables must be sorted and unique");
+
+//the DFA is a trie of the syllables, which has a state per distinct prefix.
+//as they are sorted, each syllable adds a state for every letter past the
+//ones it shares with the syllable before it
+static constexpr int countDfaStates()
+{
+    int states = 1;
+    int i = 0;
+    for (i=0; i < SYLLABLE_COUNT; i++) {
+        states += stringLength(s_syllables[i]);
+        if (i > 0) states -= commonPrefixLength(s_syllables[i], s_syllables[i-1]);
+    }
+    return states;
+}
+
+static constexpr int s_dfaStateCount = countDfaStates();
+
+//state 0 is the start, and no letter leads back to it, so 0 in next[]
+//means there is no syllable that goes on with that letter
+struct PinyinDfa {
+    short next[s_dfaStateCount][26];
+    short syllable[s_dfaStateCount];   //the syllable ending here, or -1
+};
+
+static constexpr PinyinDfa buildPinyinDfa()
+{
+    PinyinDfa dfa = {};
+    int stateCount = 1;
+    int i = 0;
+    for (i=0; i < s_dfaStateCount; i++) dfa.syllable[i] = -1;
+    for (i=0; i < SYLLABLE_COUNT; i++) {
+        const char* s = s_syllables[i];
+        int state = 0;
+        int j = 0;
+        for (j=0; s[j] != 0; j++) {
+            int letter = s[j] - 'a';
+            if (dfa.next[state][letter] == 0) dfa.next[state][letter] = stateCount++;
+            state = dfa.next[state][letter];
+        }
+        dfa.syllable[state] = i;
+    }
+    return dfa;
+}
+
+static constexpr PinyinDfa s_dfa = buildPinyinDfa();
+
+struct ToneMarkRule {
+    char16_t vowels[3];
+    int offset;
+};
+
+//where a tone mark goes: the first of these found in the syllable decides,
+//e.g. "guai" has "ai" so the mark goes on the a, and "gui" has "ui" so it
+//goes on the i
+static constexpr ToneMarkRule s_toneMarkRules[] =
+{
+    { u"ai", 0 }, //"a*i"
+    { u"ao", 0 }, //"a*o"
+    { u"ei", 0 }, //"e*i"
+    { u"ou", 0 }, //"o*u"
+    { u"ia", 1 }, //"ia*"
+    { u"ie", 1 }, //"ie*"
+    { u"iu", 1 }, //"iu*"
+    { u"io", 1 }, //"io*"
+    { u"ua", 1 }, //"ua*"
+    { u"ue", 1 }, //"ue*"
+    { u"ui", 1 }, //"ui*"
+    { u"uo", 1 }, //"uo*"
+    { u"üe", 1 }, //"üe*"
+    { u"a",  0 },
+    { u"e",  0 },
+    { u"i",  0 },
+    { u"o",  0 },
+    { u"u",  0 },
+    { u"ü",  0 }
+};
+
+#define TONE_MARK_RULE_COUNT ((int)(sizeof(s_toneMarkRules) / sizeof(s_toneMarkRules[0])))
+
+//the rules applied to one of s_syllables, where ü is spelt v
+static constexpr int spellingToneMarkPosition(const char* spelling)
+{
+    int rule = 0;
+    for (rule=0; rule < TONE_MARK_RULE_COUNT; rule++) {
+        const char16_t* vowels = s_toneMarkRules[rule].vowels;
+        int i = 0;
+        for (i=0; spelling[i] != 0; i++) {
+            int j = 0;
+            while (vowels[j] != 0) {
+                char16_t c = (spelling[i + j] == 'v') ? u'ü' : spelling[i + j];
+                if (c != vowels[j]) break;
+                j++;
+            }
+            if (vowels[j] == 0) return i + s_toneMarkRules[rule].offset;
+        }
+    }
+    return -1;
+}
+
+struct ToneMarkPositions {
+    signed char position[SYLLABLE_COUNT];
+};
+
+static constexpr ToneMarkPositions buildToneMarkPositions()
+{
+    ToneMarkPositions positions = {};
+    int i = 0;
+    for (i=0; i < SYLLABLE_COUNT; i++) positions.position[i] = spellingToneMarkPosition(s_syllables[i]);
+    return positions;
+}
+
+static constexpr ToneMarkPositions s_toneMarkPositions = buildToneMarkPositions();
+
+struct ToneMarkedVowel {
+    char16_t ucs2;
+    char letter;
+    uchar tone;
+};
+
+//the tone marked vowels, for input such as "xī'ān"
+static constexpr ToneMarkedVowel s_toneMarkedVowels[] =
+{
+    { u'ā', 'a', 1 }, { u'á', 'a', 2 }, { u'ǎ', 'a', 3 }, { u'à', 'a', 4 },
+    { u'ō', 'o', 1 }, { u'ó', 'o', 2 }, { u'ǒ', 'o', 3 }, { u'ò', 'o', 4 },
+    { u'ē', 'e', 1 }, { u'é', 'e', 2 }, { u'ě', 'e', 3 }, { u'è', 'e', 4 },
+    { u'ī', 'i', 1 }, { u'í', 'i', 2 }, { u'ǐ', 'i', 3 }, { u'ì', 'i', 4 },
+    { u'ū', 'u', 1 }, { u'ú', 'u', 2 }, { u'ǔ', 'u', 3 }, { u'ù', 'u', 4 },
+    { u'ǖ', 'v', 1 }, { u'ǘ', 'v', 2 }, { u'ǚ', 'v', 3 }, { u'ǜ', 'v', 4 },
+    { u'Ā', 'a', 1 }, { u'Á', 'a', 2 }, { u'Ǎ', 'a', 3 }, { u'À', 'a', 4 },
+    { u'Ō', 'o', 1 }, { u'Ó', 'o', 2 }, { u'Ǒ', 'o', 3 }, { u'Ò', 'o', 4 },
+    { u'Ē', 'e', 1 }, { u'É', 'e', 2 }, { u'Ě', 'e', 3 }, { u'È', 'e', 4 },
+    { u'Ī', 'i', 1 }, { u'Í', 'i', 2 }, { u'Ǐ', 'i', 3 }, { u'Ì', 'i', 4 },
+    { u'Ū', 'u', 1 }, { u'Ú', 'u', 2 }, { u'Ǔ', 'u', 3 }, { u'Ù', 'u', 4 },
+    { u'Ǖ', 'v', 1 }, { u'Ǘ', 'v', 2 }, { u'Ǚ', 'v', 3 }, { u'Ǜ', 'v', 4 }
+};
+
+#define TONE_MARKED_VOWEL_COUNT ((int)(sizeof(s_toneMarkedVowels) / sizeof(s_toneMarkedVowels[0])))
+
+//the input reduced to the DFA's letters a-z, with where each came from
+struct PinyinLetters {
+    int count;
+    char letters[MAX_PINYIN_SEGMENT_LENGTH];
+    uchar start[MAX_PINYIN_SEGMENT_LENGTH];
+    uchar end[MAX_PINYIN_SEGMENT_LENGTH];
+    uchar tone[MAX_PINYIN_SEGMENT_LENGTH];
+    //a separator or tone digit was typed just before this letter
+    bool boundaryBefore[MAX_PINYIN_SEGMENT_LENGTH + 1];
+};
+
+//false if the text has anything that can't be pinyin
+static bool readPinyinLetters(const QChar* text, int length, PinyinLetters& letters)
+{
+    letters.count = 0;
+    bool boundary = false;
+    int i;
+    for (i=0; i < length; i++) {
+        ushort c = text[i].unicode();
+        char letter = 0;
+        uchar tone = 0;
+        if ((c >= 'A') && (c <= 'Z')) c += 'a' - 'A';
+
+        if ((c >= 'a') && (c <= 'z')) {
+            letter = (char)c;
+        } else if ((c == 0x00FC) || (c == 0x00DC)) {   //ü Ü
+            letter = 'v';
+        } else if (c == ':') {
+            //"u:" is ü
+            int last = letters.count - 1;
+            if ((last < 0) || boundary || (letters.letters[last] != 'u')) return false;
+            letters.letters[last] = 'v';
+            letters.end[last] = i + 1;
+            continue;
+        } else if ((c >= '1') && (c <= '5')) {
+            if ((letters.count == 0) || boundary) return false;
+            letters.tone[letters.count - 1] = c - '0';
+            boundary = true;
+            continue;
+        } else if ((c == '\'') || text[i].isSpace()) {
+            boundary = true;
+            continue;
+        } else {
+            int j;
+            for (j=0; j < TONE_MARKED_VOWEL_COUNT; j++) {
+                if (s_toneMarkedVowels[j].ucs2 == c) break;
+            }
+            if (j == TONE_MARKED_VOWEL_COUNT) return false;
+            letter = s_toneMarkedVowels[j].letter;
+            tone = s_toneMarkedVowels[j].tone;
+        }
+
+        int n = letters.count++;
+        letters.letters[n] = letter;
+        letters.start[n] = i;
+        letters.end[n] = i + 1;
+        letters.tone[n] = tone;
+        letters.boundaryBefore[n] = boundary && (n > 0);
+        boundary = false;
+    }
+    letters.boundaryBefore[letters.count] = true;
+    return letters.count > 0;
+}
+
+//the DFA states for each syllable that could start at letter first.
+//states[k] is for the piece first..first+k, or 0 if there is no such piece.
+//a piece has to be a whole syllable unless it ends at a boundary, where the
+//user may have only typed the start of one
+static void findPieces(const PinyinLetters& letters, int first, short states[MAX_SYLLABLE_LETTERS + 1])
+{
+    int state = 0;
+    int k;
+    for (k=0; k <= MAX_SYLLABLE_LETTERS; k++) states[k] = 0;
+    for (k=1; (k <= MAX_SYLLABLE_LETTERS) && (first + k <= letters.count); k++) {
+        if ((k > 1) && letters.boundaryBefore[first + k - 1]) break;
+        state = s_dfa.next[state][letters.letters[first + k - 1] - 'a'];
+        if (state == 0) break;
+        if ((s_dfa.syllable[state] >= 0) || letters.boundaryBefore[first + k]) states[k] = state;
+    }
+}
+
+static void appendSyllable(const PinyinLetters& letters, int first, int length, int state,
+                           PinyinSegmentation& segmentation)
+{
+    PinyinSyllable& syllable = segmentation.syllables[segmentation.count++];
+    int last = first + length - 1;
+    syllable.id = (s_dfa.syllable[state] >= 0) ? s_dfa.syllable[state] : PARTIAL_PINYIN_SYLLABLE;
+    syllable.start = letters.start[first];
+    syllable.length = letters.end[last] - letters.start[first];
+    syllable.tone = 0;
+    int i;
+    for (i=first; i <= last; i++) {
+        if (letters.tone[i] != 0) syllable.tone = letters.tone[i];
+    }
+}
+
+static bool sameSplit(const PinyinSegmentation& a, const PinyinSegmentation& b)
+{
+    if (a.count != b.count) return false;
+    int i;
+    for (i=0; i < a.count; i++) {
+        if (a.syllables[i].start != b.syllables[i].start) return false;
+    }
+    return true;
+}
+
+//the same cost segmentPinyin() uses to pick the best split
+static int splitCost(const PinyinSegmentation& segmentation)
+{
+    int cost = 0;
+    int i;
+    for (i=0; i < segmentation.count; i++) {
+        cost += (segmentation.syllables[i].id == PARTIAL_PINYIN_SYLLABLE) ? 3 : 2;
+    }
+    return cost;
+}
+
+//what the depth first search for the other alternatives needs
+struct SegmentSearch {
+    const PinyinLetters* letters;
+    const uchar* cost;          //0xFF for letters the rest can't be split from
+    PinyinSegmentation current;
+    PinyinSegmentation* alternatives;
+    int found;
+    int maxAlternatives;
+};
+
+//longer syllables are tried first. only letters the rest can be split from
+//are visited, so every path ends in an alternative and the search stops
+//as soon as it has enough
+static void searchSegmentations(SegmentSearch& search, int first)
+{
+    if (first == search.letters->count) {
+        if (!sameSplit(search.current, search.alternatives[0])) {
+            search.alternatives[search.found++] = search.current;
+        }
+        return;
+    }
+    short states[MAX_SYLLABLE_LETTERS + 1];
+    findPieces(*search.letters, first, states);
+    int k;
+    for (k=MAX_SYLLABLE_LETTERS; (k > 0) && (search.found < search.maxAlternatives); k--) {
+        if ((states[k] == 0) || (search.cost[first + k] == 0xFF)) continue;
+        int count = search.current.count;
+        appendSyllable(*search.letters, first, k, states[k], search.current);
+        searchSegmentations(search, first + k);
+        search.current.count = count;
+    }
+}
+
+int segmentPinyin(const QChar* text, int length, PinyinSegmentation* alternatives, int maxAlternatives)
+{
+    if ((length > MAX_PINYIN_SEGMENT_LENGTH) || (maxAlternatives < 1)) return 0;
+
+    PinyinLetters letters;
+    if (!readPinyinLetters(text, length, letters)) return 0;
+
+    //the cheapest split of the letters from each one on, and the length of
+    //its first syllable. a syllable costs 2, or 3 if it is partial, so that
+    //"nver" is "nv er" and not "nve r". ties go to the longer syllable
+    uchar cost[MAX_PINYIN_SEGMENT_LENGTH + 1];
+    uchar bestLength[MAX_PINYIN_SEGMENT_LENGTH + 1];
+    short bestState[MAX_PINYIN_SEGMENT_LENGTH + 1];
+    cost[letters.count] = 0;
+    int first;
+    for (first=letters.count - 1; first >= 0; first--) {
+        short states[MAX_SYLLABLE_LETTERS + 1];
+        findPieces(letters, first, states);
+        cost[first] = 0xFF;
+        int k;
+        for (k=MAX_SYLLABLE_LETTERS; k > 0; k--) {
+            if ((states[k] == 0) || (cost[first + k] == 0xFF)) continue;
+            int pieceCost = (s_dfa.syllable[states[k]] >= 0) ? 2 : 3;
+            if (cost[first + k] + pieceCost < cost[first]) {
+                cost[first] = cost[first + k] + pieceCost;
+                bestLength[first] = k;
+                bestState[first] = states[k];
+            }
+        }
+    }
+    if (cost[0] == 0xFF) return 0;
+
+    alternatives[0].count = 0;
+    for (first=0; first < letters.count; first += bestLength[first]) {
+        appendSyllable(letters, first, bestLength[first], bestState[first], alternatives[0]);
+    }
+
+    SegmentSearch search;
+    search.letters = &letters;
+    search.cost = cost;
+    search.current.count = 0;
+    search.alternatives = alternatives;
+    search.found = 1;
+    search.maxAlternatives = maxAlternatives;
+    if (maxAlternatives > 1) searchSegmentations(search, 0);
+
+    //the rest cheapest first too
+    int i;
+    for (i=2; i < search.found; i++) {
+        int j;
+        for (j=i; (j > 1) && (splitCost(alternatives[j]) < splitCost(alternatives[j-1])); j--) {
+            PinyinSegmentation swap = alternatives[j];
+            alternatives[j] = alternatives[j-1];
+            alternatives[j-1] = swap;
+        }
+    }
+    return search.found;
+}
+
+int pinyinSyllableCount()
+{
+    return SYLLABLE_COUNT;
+}
+
+const char* pinyinSyllableText(int id)
+{
+    if ((id < 0) || (id >= SYLLABLE_COUNT)) return "";
+    return s_syllables[id];
+}
+
+int pinyinSyllableId(const QString& syllable)
+{
+    if (syllable.isEmpty()) return -1;
+    int state = 0;
+    int i;
+    for (i=0; i < syllable.length(); i++) {
+        ushort c = syllable.at(i).unicode();
+        if ((c == 0x00FC) || (c == 0x00DC)) c = 'v';
+        if ((c >= 'A') && (c <= 'Z')) c += 'a' - 'A';
+        if ((c < 'a') || (c > 'z')) return -1;
+        state = s_dfa.next[state][c - 'a'];
+        if (state == 0) return -1;
+    }
+    return s_dfa.syllable[state];
+}
+
+static const char* s_vowellessSyllables[] = { "m", "n", "ng", "hm", "hng" };
+
+bool isVowellessSyllable(const QChar* text, int length)
+{
+    uint i;
+    for (i=0; i < sizeof(s_vowellessSyllables) / sizeof(s_vowellessSyllables[0]); i++) {
+        const char* syllable = s_vowellessSyllables[i];
+        int j;
+        for (j=0; (j < length) && (syllable[j] != 0); j++) {
+            if (text[j].toLower() != QChar(syllable[j])) break;
+        }
+        if ((j == length) && (syllable[j] == 0)) return true;
+    }
+    return false;
+}
+
+//the rules applied to any text, for what isn't a syllable
+static int ruleToneMarkPosition(const QChar* syllable, int length)
+{
+    int rule;
+    for (rule=0; rule < TONE_MARK_RULE_COUNT; rule++) {
+        const char16_t* vowels = s_toneMarkRules[rule].vowels;
+        int i;
+        for (i=0; i < length; i++) {
+            int j = 0;
+            while ((vowels[j] != 0) && (i + j < length) && (syllable[i + j].toLower().unicode() == vowels[j])) j++;
+            if (vowels[j] == 0) return i + s_toneMarkRules[rule].offset;
+        }
+    }
+    return -1;
+}
+
+int findToneMarkPosition(const QChar* syllable, int length)
+{
+    //a whole syllable is one walk through the DFA and a table lookup.
+    //its ü has to be spelt ü, a v is left alone
+    int state = 0;
+    int i;
+    for (i=0; (i < length) && (i < MAX_SYLLABLE_LETTERS); i++) {
+        ushort c = syllable[i].unicode();
+        if ((c == 0x00FC) || (c == 0x00DC)) {
+            c = 'v';
+        } else {
+            if ((c >= 'A') && (c <= 'Z')) c += 'a' - 'A';
+            if ((c < 'a') || (c > 'z') || (c == 'v')) break;
+        }
+        state = s_dfa.next[state][c - 'a'];
+        if (state == 0) break;
+    }
+    if ((i == length) && (state != 0) && (s_dfa.syllable[state] >= 0)) {
+        return s_toneMarkPositions.position[s_dfa.syllable[state]];
+    }
+    return ruleToneMarkPosition(syllable, length);
+}
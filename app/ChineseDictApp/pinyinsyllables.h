@@ -0,0 +1,75 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef PINYINSYLLABLES_H
+#define PINYINSYLLABLES_H
+
+#include <QChar>
+#include <QString>
+
+//the longest input segmentPinyin() will look at, in QChars
+#define MAX_PINYIN_SEGMENT_LENGTH 64
+
+//the id of a syllable that was cut short by a separator or the end of the
+//input, e.g. the "g" of "zhongg"
+#define PARTIAL_PINYIN_SYLLABLE (-1)
+
+//one syllable of segmented pinyin
+struct PinyinSyllable {
+    short id;       //see pinyinSyllableText(), or PARTIAL_PINYIN_SYLLABLE
+    uchar start;    //where it is in the input, in QChars
+    uchar length;
+    uchar tone;     //1-5 from a tone digit or tone mark, 0 if none was given
+};
+
+//one way of splitting the input into syllables
+struct PinyinSegmentation {
+    int count;
+    PinyinSyllable syllables[MAX_PINYIN_SEGMENT_LENGTH];
+};
+
+//splits pinyin typed with or without syllable boundaries into syllables,
+//using a DFA over every legal syllable that is built at compile time.
+//ü may also be typed as "v" or "u:", and tone digits and tone marks are
+//picked up. spaces and ' are boundaries no syllable can cross.
+//run-together input can often be split more than one way, e.g. "xian" is
+//"xian" or "xi an", so up to maxAlternatives splits are written to
+//alternatives, those with the fewest syllables and the fewest partial
+//syllables first.
+//returns how many were found, 0 if the input is not pinyin.
+//nothing is allocated, so it is cheap enough to run on every keystroke
+int segmentPinyin(const QChar* text, int length, PinyinSegmentation* alternatives, int maxAlternatives);
+inline int segmentPinyin(const QString& text, PinyinSegmentation* alternatives, int maxAlternatives)
+{
+    return segmentPinyin(text.constData(), text.length(), alternatives, maxAlternatives);
+}
+
+//the syllables are numbered in alphabetical order, with ü spelt "v"
+int pinyinSyllableCount();
+const char* pinyinSyllableText(int id);
+//the id of one whole toneless syllable, or -1
+int pinyinSyllableId(const QString& syllable);
+//true for the interjections m, n, ng, hm and hng, in any case.
+//they have no vowel, so typed on their own they look like initials
+bool isVowellessSyllable(const QChar* text, int length);
+
+//where the tone mark goes in a syllable, e.g. 2 for "Guai" or "lüe",
+//or -1 if it has no vowel. whole syllables are looked up in a table made
+//at compile time, anything else has the same rules applied as it is
+int findToneMarkPosition(const QChar* syllable, int length);
+
+#endif // PINYINSYLLABLES_H
@@ -0,0 +1,288 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <QtConcurrent>
+#include <QDebug>
+#include <algorithm>
+#include <math.h>
+
+#include "segmenter.h"
+
+//added to every word, so that fewer, longer words are preferred
+#define WORD_COST 10.0f
+//word_rank given to words missing from the frequency list by dbcreator
+#define UNRANKED_WORD_RANK 999999
+//a hanzi that starts no dictionary word
+#define UNKNOWN_HANZI_COST (WORD_COST + 20.0f)
+//a run of latin letters, digits, spaces or punctuation, costed like an
+//unranked word so that a headword containing it (e.g. "卡拉OK") wins
+#define OTHER_RUN_COST (WORD_COST + (float)log((double)UNRANKED_WORD_RANK))
+
+//segmentParallel() pieces are about this long, ending at a sentence end
+#define PARALLEL_CHUNK_LENGTH 16384
+
+static float wordCost(int wordRank)
+{
+    return WORD_COST + (float)log((double)qMax(wordRank, 1));
+}
+
+Segmenter::Segmenter()
+{
+}
+
+void Segmenter::addWord(const QString& headword, int wordsKey, int wordRank)
+{
+    if (headword.isEmpty()) return;
+    QList<QPair<int, int> >& keys = m_pending[headword];
+    int i;
+    for (i=0; i < keys.count(); i++) {
+        //simplified and traditional are often the same
+        if (keys[i].second == wordsKey) return;
+    }
+    keys.append(qMakePair(wordRank, wordsKey));
+}
+
+//lays the trie out breadth first from the sorted headwords.
+//each queued node covers a run of headwords sharing its prefix
+void Segmenter::build()
+{
+    QStringList headwords = m_pending.keys();
+    std::sort(headwords.begin(), headwords.end());
+
+    m_nodeChars.clear();
+    m_nodeFirstChild.clear();
+    m_nodeChildCount.clear();
+    m_nodeWord.clear();
+    m_wordCosts.clear();
+    m_wordsKeysStart.clear();
+    m_wordsKeys.clear();
+
+    struct Range { int node; int low; int high; int depth; };
+    QList<Range> queue;
+    m_nodeChars.append(0);
+    m_nodeFirstChild.append(0);
+    m_nodeChildCount.append(0);
+    m_nodeWord.append(-1);
+    Range root = { 0, 0, headwords.count(), 0 };
+    queue.append(root);
+
+    while (!queue.isEmpty()) {
+        Range range = queue.takeFirst();
+        int low = range.low;
+        if ((low < range.high) && (headwords[low].length() == range.depth)) {
+            //this node ends a headword
+            QList<QPair<int, int> > keys = m_pending.value(headwords[low]);
+            std::sort(keys.begin(), keys.end());
+            m_nodeWord[range.node] = m_wordCosts.count();
+            m_wordCosts.append(wordCost(keys.first().first));
+            m_wordsKeysStart.append(m_wordsKeys.count());
+            int i;
+            for (i=0; i < keys.count(); i++) {
+                m_wordsKeys.append(keys[i].second);
+            }
+            low++;
+        }
+
+        m_nodeFirstChild[range.node] = m_nodeChars.count();
+        while (low < range.high) {
+            ushort c = headwords[low].at(range.depth).unicode();
+            int high = low + 1;
+            while ((high < range.high) && (headwords[high].at(range.depth).unicode() == c)) high++;
+
+            Range childRange = { m_nodeChars.count(), low, high, range.depth + 1 };
+            m_nodeChars.append(c);
+            m_nodeFirstChild.append(0);
+            m_nodeChildCount.append(0);
+            m_nodeWord.append(-1);
+            m_nodeChildCount[range.node]++;
+            queue.append(childRange);
+            low = high;
+        }
+    }
+    m_wordsKeysStart.append(m_wordsKeys.count());
+    m_pending.clear();
+
+    m_nodeChars.squeeze();
+    m_nodeFirstChild.squeeze();
+    m_nodeChildCount.squeeze();
+    m_nodeWord.squeeze();
+    m_wordCosts.squeeze();
+    m_wordsKeysStart.squeeze();
+    m_wordsKeys.squeeze();
+}
+
+//the child of node for character c, or -1
+int Segmenter::child(int node, ushort c) const
+{
+    const ushort* first = m_nodeChars.constData() + m_nodeFirstChild[node];
+    const ushort* last = first + m_nodeChildCount[node];
+    const ushort* it = std::lower_bound(first, last, c);
+    if ((it == last) || (*it != c)) return -1;
+    return it - m_nodeChars.constData();
+}
+
+QList<int> Segmenter::wordsKeysFor(int word) const
+{
+    QList<int> result;
+    int i;
+    for (i=m_wordsKeysStart[word]; i < m_wordsKeysStart[word + 1]; i++) {
+        result.append(m_wordsKeys[i]);
+    }
+    return result;
+}
+
+static bool isOtherPunctuation(QChar c)
+{
+    return !c.isLetterOrNumber() && !c.isSurrogate() && (c.script() != QChar::Script_Han);
+}
+
+//where a piece of text with no dictionary word starting at position ends
+static int otherRunEnd(const QString& text, int position, float& cost)
+{
+    QChar c = text.at(position);
+    if (c.isHighSurrogate() && (position + 1 < text.length())) {
+        cost = UNKNOWN_HANZI_COST;
+        return position + 2;
+    }
+    if (c.script() == QChar::Script_Han) {
+        cost = UNKNOWN_HANZI_COST;
+        return position + 1;
+    }
+
+    //group letters and digits together, and everything else together
+    cost = OTHER_RUN_COST;
+    bool isWord = c.isLetterOrNumber();
+    int end = position + 1;
+    while ((end < text.length()) &&
+           (text.at(end).script() != QChar::Script_Han) &&
+           !text.at(end).isSurrogate() &&
+           (text.at(end).isLetterOrNumber() == isWord)) {
+        end++;
+    }
+    return end;
+}
+
+//dynamic programming over positions: best[i] is the lowest cost of
+//segmenting the first i characters
+QList<TextSegment> Segmenter::segment(const QString& text) const
+{
+    QList<TextSegment> result;
+    int length = text.length();
+    if (length == 0) return result;
+
+    QVector<float> best(length + 1, HUGE_VALF);
+    QVector<int> from(length + 1, 0);
+    QVector<int> word(length + 1, -1);
+    best[0] = 0;
+
+    //a run of letters and digits, or of punctuation, ends in the same place
+    //from anywhere inside it, so each run is only scanned once. otherwise a
+    //long one (a url, a line of "====") would be quadratic
+    int runEnd = 0;
+    float runCost = 0;
+
+    const QChar* data = text.constData();
+    int i;
+    for (i=0; i < length; i++) {
+        if (i >= runEnd) runEnd = otherRunEnd(text, i, runCost);
+        float otherCost = runCost;
+        int end = runEnd;
+        if (best[i] + otherCost < best[end]) {
+            best[end] = best[i] + otherCost;
+            from[end] = i;
+            word[end] = -1;
+        }
+
+        if (m_nodeChars.isEmpty()) continue;
+        int node = 0;
+        int j;
+        for (j=i; j < length; j++) {
+            node = child(node, data[j].unicode());
+            if (node < 0) break;
+            int w = m_nodeWord[node];
+            if ((w >= 0) && (best[i] + m_wordCosts[w] < best[j + 1])) {
+                best[j + 1] = best[i] + m_wordCosts[w];
+                from[j + 1] = i;
+                word[j + 1] = w;
+            }
+        }
+    }
+
+    int end = length;
+    while (end > 0) {
+        TextSegment segment;
+        segment.start = from[end];
+        segment.length = end - from[end];
+        if (word[end] >= 0) segment.wordsKeys = wordsKeysFor(word[end]);
+        result.prepend(segment);
+        end = from[end];
+    }
+    return result;
+}
+
+//segments one piece of the text for segmentParallel()
+struct SegmentChunk {
+    typedef QList<TextSegment> result_type;
+
+    const Segmenter* segmenter;
+    const QString* text;
+
+    SegmentChunk(const Segmenter* segmenter, const QString* text) :
+        segmenter(segmenter), text(text) {}
+
+    QList<TextSegment> operator()(const QPair<int, int>& chunk) const
+    {
+        QList<TextSegment> segments = segmenter->segment(text->mid(chunk.first, chunk.second));
+        int i;
+        for (i=0; i < segments.count(); i++) {
+            segments[i].start += chunk.first;
+        }
+        return segments;
+    }
+};
+
+bool Segmenter::isSentenceEnd(QChar c)
+{
+    return (c == '\n') || (c == QChar(0x3002)) || (c == QChar(0xFF01)) || (c == QChar(0xFF1F)) ||
+           (c == '.') || (c == '!') || (c == '?');
+}
+
+QList<TextSegment> Segmenter::segmentParallel(const QString& text) const
+{
+    //no word spans a sentence end, so the pieces segment independently
+    QList<QPair<int, int> > chunks;
+    int start = 0;
+    while (start < text.length()) {
+        int end = qMin(start + PARALLEL_CHUNK_LENGTH, text.length());
+        while ((end < text.length()) && !isSentenceEnd(text.at(end - 1))) end++;
+        //keep the rest of the punctuation run, otherRunEnd() would group it
+        while ((end < text.length()) && isOtherPunctuation(text.at(end))) end++;
+        chunks.append(qMakePair(start, end - start));
+        start = end;
+    }
+    if (chunks.count() < 2) return segment(text);
+
+    QList<QList<TextSegment> > pieces =
+            QtConcurrent::blockingMapped(chunks, SegmentChunk(this, &text));
+
+    QList<TextSegment> result;
+    int i;
+    for (i=0; i < pieces.count(); i++) {
+        result.append(pieces[i]);
+    }
+    return result;
+}
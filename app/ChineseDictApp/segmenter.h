@@ -0,0 +1,78 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef SEGMENTER_H
+#define SEGMENTER_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+//one word of segmented text, with the entries for it most common first.
+//text that is not in the dictionary has no entries
+struct TextSegment {
+    int start;
+    int length;
+    QList<int> wordsKeys;
+};
+
+//splits chinese text into dictionary words.
+//every simplified and traditional headword is put in a trie, and the
+//segmentation with the lowest total cost wins, where a word costs more the
+//rarer it is (its word_rank) and every extra word costs a little more.
+//once built it is read only, so it can segment from several threads at once
+class Segmenter
+{
+private:
+    //the trie. the children of a node are contiguous and sorted by character
+    QVector<ushort> m_nodeChars;
+    QVector<qint32> m_nodeFirstChild;
+    QVector<qint32> m_nodeChildCount;
+    QVector<qint32> m_nodeWord;     //index into m_wordCosts, or -1
+
+    //per headword: its cost, and its words keys in m_wordsKeys
+    QVector<float> m_wordCosts;
+    QVector<qint32> m_wordsKeysStart;
+    QVector<qint32> m_wordsKeys;
+
+    //collected by addWord() until build()
+    QHash<QString, QList<QPair<int, int> > > m_pending;
+
+    int child(int node, ushort c) const;
+    QList<int> wordsKeysFor(int word) const;
+
+public:
+    Segmenter();
+
+    void addWord(const QString& headword, int wordsKey, int wordRank);
+    void build();
+
+    int wordCount() const { return m_wordCosts.count(); }
+
+    QList<TextSegment> segment(const QString& text) const;
+
+    //the same result as segment(), with the text split at sentence ends
+    //and the pieces segmented on the global thread pool
+    QList<TextSegment> segmentParallel(const QString& text) const;
+
+    //no headword spans one of these, so text can be split after them
+    static bool isSentenceEnd(QChar c);
+};
+
+#endif // SEGMENTER_H
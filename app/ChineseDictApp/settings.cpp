@@ -22,6 +22,7 @@
 #include <sys/stat.h>
 
 #include "settings.h"
+#include "logging.h"
 #include "dictdb.h"
 
 #define DB_NAME ".chinesedict.settings.1.db"
@@ -37,8 +38,8 @@ void Settings::prepareStatement(QString& query, sqlite3_stmt** stmt)
         NULL);
 
     if (ret != SQLITE_OK) {
-        qDebug() << "Error preparing statement <" << query << "> ";
-        qDebug() << "error: " << sqlite3_errmsg(m_prefsDb);
+        qCWarning(lcSettings) << "Error preparing statement <" << query << "> ";
+        qCWarning(lcSettings) << "error: " << sqlite3_errmsg(m_prefsDb);
       assert(false);
     }
     assert(stmt);
@@ -49,22 +50,22 @@ Settings::Settings()
     QString settingsDirectory = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
     //QString settingsDirectory = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);  //TODO
     QString settingsFilePath = settingsDirectory + "/" + DB_NAME;
-    qDebug() << "x settings db path: " << settingsFilePath;
+    qCDebug(lcSettings) << "x settings db path: " << settingsFilePath;
     if (!QFile(settingsFilePath).exists()) {
-        qDebug() << "creating db";
+        qCDebug(lcSettings) << "creating db";
         if (!QDir().mkpath(settingsDirectory)) {
-            qDebug() << "error creating directory, exiting";
+            qCWarning(lcSettings) << "error creating directory, exiting";
             exit(1);
         }
         if (!createDb(settingsFilePath)) {
-            qDebug() << "error creating db, exiting";
+            qCWarning(lcSettings) << "error creating db, exiting";
             exit(1);
         }
         chmod(settingsFilePath.toLatin1(), S_IRUSR|S_IWUSR|S_IROTH|S_IWOTH);
     }
     int ret = sqlite3_open_v2(settingsFilePath.toLatin1(), &m_prefsDb, SQLITE_OPEN_READWRITE, NULL);
     if ((ret == SQLITE_OK) && (m_prefsDb != NULL)) {
-        qDebug() << " opened" << settingsFilePath;
+        qCDebug(lcSettings) << " opened" << settingsFilePath;
     }
 
     QString query;
@@ -93,7 +94,7 @@ bool Settings::createDb(const QString &filePath)
     //no db, try to create one
     int ret = sqlite3_open_v2(filePath.toLatin1(), &m_prefsDb, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
     if ((ret != SQLITE_OK) || (m_prefsDb == NULL)) {
-        qDebug() << "Error creating settings database: " << ret;
+        qCWarning(lcSettings) << "Error creating settings database: " << ret;
         return false;
      }
 
@@ -109,10 +110,10 @@ bool Settings::createDb(const QString &filePath)
          NULL, 0, &errmsg);
 
     if(ret != SQLITE_OK) {
-        qDebug() << "Error creating favourites table: " << errmsg;
+        qCWarning(lcSettings) << "Error creating favourites table: " << errmsg;
       return false;
     }
-    qDebug() << "created favourites table ok";
+    qCDebug(lcSettings) << "created favourites table ok";
 
     ret = sqlite3_exec(m_prefsDb,
         "CREATE TABLE preferences ( "
@@ -128,7 +129,7 @@ bool Settings::createDb(const QString &filePath)
          NULL, 0, &errmsg);
 
     if(ret != SQLITE_OK) {
-        qDebug() << "Error creating preferences table: " << errmsg;
+        qCWarning(lcSettings) << "Error creating preferences table: " << errmsg;
       return false;
     }
 
@@ -137,11 +138,11 @@ bool Settings::createDb(const QString &filePath)
          NULL, 0, &errmsg);
 
     if(ret != SQLITE_OK) {
-        qDebug() << "Error inserting default values into preferences table: " << errmsg;
+        qCWarning(lcSettings) << "Error inserting default values into preferences table: " << errmsg;
       return false;
     }
 
-    qDebug() << "created preferences table ok";
+    qCDebug(lcSettings) << "created preferences table ok";
 
     return true;
 }
@@ -151,7 +152,7 @@ void Settings::loadPreferences()
     sqlite3_stmt* stmt = m_getPreferencesStmt;
     int ret = sqlite3_step(stmt);
     if ((ret != SQLITE_ROW) && (ret != SQLITE_DONE)) {
-        qDebug() << "Error reading from preferences table " << ret;
+        qCWarning(lcSettings) << "Error reading from preferences table " << ret;
     }
     m_searchByChinese = sqlite3_column_int(stmt, 0);
     m_useTraditional = sqlite3_column_int(stmt, 1);
@@ -161,14 +162,16 @@ void Settings::loadPreferences()
     m_tone3Color = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 5));
     m_tone4Color = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 6));
     m_tone5Color = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 7));
+    m_fuzzyPinyin = sqlite3_column_int(stmt, 8); //stored in spare1
 
-    qDebug() << "searchByChinese " << m_searchByChinese;
-    qDebug() << "useTraditional " << m_useTraditional;
-    qDebug() << "m_tone1Color " << m_tone1Color;
-    qDebug() << "m_tone2Color " << m_tone2Color;
-    qDebug() << "m_tone3Color " << m_tone3Color;
-    qDebug() << "m_tone4Color " << m_tone4Color;
-    qDebug() << "m_tone5Color " << m_tone5Color;
+    qCDebug(lcSettings) << "searchByChinese " << m_searchByChinese;
+    qCDebug(lcSettings) << "useTraditional " << m_useTraditional;
+    qCDebug(lcSettings) << "fuzzyPinyin " << m_fuzzyPinyin;
+    qCDebug(lcSettings) << "m_tone1Color " << m_tone1Color;
+    qCDebug(lcSettings) << "m_tone2Color " << m_tone2Color;
+    qCDebug(lcSettings) << "m_tone3Color " << m_tone3Color;
+    qCDebug(lcSettings) << "m_tone4Color " << m_tone4Color;
+    qCDebug(lcSettings) << "m_tone5Color " << m_tone5Color;
 
     sqlite3_reset(stmt);
 }
@@ -219,7 +222,7 @@ void Settings::addFavourite(int key,
     sqlite3_reset(stmt);
     //qDebug() << "addFavourite " << ret;
     if(ret != SQLITE_DONE) {
-        qDebug() << "Error inserting into favourites table ";
+        qCWarning(lcSettings) << "Error inserting into favourites table ";
     }
     loadFavourites();
 }
@@ -232,7 +235,7 @@ void Settings::removeFavourite(int key, int listRowIndex)
     sqlite3_reset(stmt);
     //qDebug() << "removeFavourite " << ret;
     if(ret != SQLITE_DONE) {
-        qDebug() << "Error removing from favourites table ";
+        qCWarning(lcSettings) << "Error removing from favourites table ";
     }
     m_favouritesList.removeAt(listRowIndex);
     emit favouritesListChanged();
@@ -260,7 +263,7 @@ void Settings::setSearchByChinese(bool flag)
         query.toUtf8(),
         NULL, 0, &errmsg);
     if(ret != SQLITE_OK) {
-        qDebug() << "Error setting search_by_chinese flag: " << errmsg;
+        qCWarning(lcSettings) << "Error setting search_by_chinese flag: " << errmsg;
     }
 
     m_searchByChinese = flag;
@@ -281,7 +284,7 @@ void Settings::setUseTraditional(bool flag)
         query.toUtf8(),
         NULL, 0, &errmsg);
     if(ret != SQLITE_OK) {
-        qDebug() << "Error setting use_traditional flag: " << errmsg;
+        qCWarning(lcSettings) << "Error setting use_traditional flag: " << errmsg;
     }
 
     m_useTraditional = flag;
@@ -293,6 +296,27 @@ bool Settings::useTraditional()
     return m_useTraditional;
 }
 
+void Settings::setFuzzyPinyin(bool flag)
+{
+    //the preferences table predates this option, so it lives in the spare1 column
+    QString query = "UPDATE preferences SET spare1=" + QString::number(flag) + ";";
+    char* errmsg;
+    int ret = sqlite3_exec(m_prefsDb,
+        query.toUtf8(),
+        NULL, 0, &errmsg);
+    if(ret != SQLITE_OK) {
+        qCWarning(lcSettings) << "Error setting fuzzy pinyin flag: " << errmsg;
+    }
+
+    m_fuzzyPinyin = flag;
+    emit fuzzyPinyinChanged();
+}
+
+bool Settings::fuzzyPinyin()
+{
+    return m_fuzzyPinyin;
+}
+
 void Settings::setToneColorsEnabled(bool flag)
 {
 
@@ -303,7 +327,7 @@ void Settings::setToneColorsEnabled(bool flag)
         NULL, 0, &errmsg);
 
     if(ret != SQLITE_OK) {
-        qDebug() << "Error setting use_tone_colours flag: " << errmsg;
+        qCWarning(lcSettings) << "Error setting use_tone_colours flag: " << errmsg;
     }
 
     m_toneColorsEnabled = flag;
@@ -323,7 +347,7 @@ void Settings::setTone1Color(const QString &c) {
             query.toUtf8(),
             NULL, 0, &errmsg);
         if(ret != SQLITE_OK) {
-            qDebug() << "Error setting tone1_colour flag: " << errmsg;
+            qCWarning(lcSettings) << "Error setting tone1_colour flag: " << errmsg;
         }
 
         m_tone1Color = c;
@@ -343,7 +367,7 @@ void Settings::setTone2Color(const QString &c) {
             query.toUtf8(),
             NULL, 0, &errmsg);
         if(ret != SQLITE_OK) {
-            qDebug() << "Error setting tone2_colour flag: " << errmsg;
+            qCWarning(lcSettings) << "Error setting tone2_colour flag: " << errmsg;
         }
 
         m_tone2Color = c;
@@ -363,7 +387,7 @@ void Settings::setTone3Color(const QString &c) {
             query.toUtf8(),
             NULL, 0, &errmsg);
         if(ret != SQLITE_OK) {
-            qDebug() << "Error setting tone3_colour flag: " << errmsg;
+            qCWarning(lcSettings) << "Error setting tone3_colour flag: " << errmsg;
         }
 
         m_tone3Color = c;
@@ -383,7 +407,7 @@ void Settings::setTone4Color(const QString &c) {
             query.toUtf8(),
             NULL, 0, &errmsg);
         if(ret != SQLITE_OK) {
-            qDebug() << "Error setting tone4_colour flag: " << errmsg;
+            qCWarning(lcSettings) << "Error setting tone4_colour flag: " << errmsg;
         }
 
         m_tone4Color = c;
@@ -403,7 +427,7 @@ void Settings::setTone5Color(const QString &c) {
             query.toUtf8(),
             NULL, 0, &errmsg);
         if(ret != SQLITE_OK) {
-            qDebug() << "Error setting tone5_colour flag: " << errmsg;
+            qCWarning(lcSettings) << "Error setting tone5_colour flag: " << errmsg;
         }
 
         m_tone5Color = c;
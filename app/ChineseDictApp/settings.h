@@ -43,6 +43,7 @@ private:
 
     bool m_useTraditional;
     bool m_searchByChinese;
+    bool m_fuzzyPinyin;
 
     bool m_toneColorsEnabled;
     QString m_tone1Color;
@@ -85,6 +86,10 @@ public:
     void setUseTraditional(bool flag);
     bool useTraditional();
     
+    Q_PROPERTY(bool fuzzyPinyin READ fuzzyPinyin WRITE setFuzzyPinyin NOTIFY fuzzyPinyinChanged)
+    void setFuzzyPinyin(bool flag);
+    bool fuzzyPinyin();
+
     Q_PROPERTY(bool toneColorsEnabled READ toneColorsEnabled WRITE setToneColorsEnabled NOTIFY toneColorsEnabledChanged)
     void setToneColorsEnabled(bool flag);
     bool toneColorsEnabled();
@@ -136,6 +141,7 @@ signals:
     void favouritesListChanged();
     void searchByChineseChanged();
     void useTraditionalChanged();
+    void fuzzyPinyinChanged();
     void toneColorsEnabledChanged();
     void tone1ColorChanged();
     void tone2ColorChanged();
@@ -0,0 +1,90 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <QDebug>
+#include <QHash>
+
+#include "textannotator.h"
+#include "logging.h"
+#include "sqlite3.h"
+
+TextAnnotator::TextAnnotator(const QString& dbPath) :
+    m_lookup(dbPath)
+{
+    loadHeadwords(dbPath);
+}
+
+//puts every simplified and traditional headword in the segmenter
+bool TextAnnotator::loadHeadwords(const QString& dbPath)
+{
+    sqlite3* db;
+    int ret = sqlite3_open_v2(dbPath.toUtf8(), &db, SQLITE_OPEN_READONLY, NULL);
+    if (ret != SQLITE_OK) {
+        qCWarning(lcSearch) << "TextAnnotator: error opening " << dbPath;
+        sqlite3_close(db);
+        return false;
+    }
+
+    sqlite3_stmt* stmt;
+    QByteArray query = "SELECT rowid, traditional, simplified, word_rank FROM words";
+    ret = sqlite3_prepare_v2(db, query.constData(), query.size(), &stmt, NULL);
+    if (ret != SQLITE_OK) {
+        qCWarning(lcSearch) << "TextAnnotator: error: " << sqlite3_errmsg(db);
+        sqlite3_close(db);
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int wordsKey = sqlite3_column_int(stmt, 0);
+        int wordRank = sqlite3_column_int(stmt, 3);
+        m_segmenter.addWord(QString::fromUtf8((const char*)sqlite3_column_text(stmt, 1)), wordsKey, wordRank);
+        m_segmenter.addWord(QString::fromUtf8((const char*)sqlite3_column_text(stmt, 2)), wordsKey, wordRank);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    m_segmenter.build();
+    qCDebug(lcSearch) << "TextAnnotator: " << m_segmenter.wordCount() << " headwords";
+    return true;
+}
+
+QList<AnnotatedSegment> TextAnnotator::annotate(const QString& text, bool parallel)
+{
+    QList<TextSegment> segments = parallel ? m_segmenter.segmentParallel(text)
+                                           : m_segmenter.segment(text);
+
+    //read every entry needed in one go
+    QList<int> wordsKeys;
+    int i;
+    for (i=0; i < segments.count(); i++) {
+        wordsKeys.append(segments[i].wordsKeys);
+    }
+    QHash<int, LookupEntry> entries = m_lookup.entries(wordsKeys);
+
+    QList<AnnotatedSegment> result;
+    for (i=0; i < segments.count(); i++) {
+        AnnotatedSegment annotated;
+        annotated.text = text.mid(segments[i].start, segments[i].length);
+        int j;
+        for (j=0; j < segments[i].wordsKeys.count(); j++) {
+            if (entries.contains(segments[i].wordsKeys[j])) {
+                annotated.entries.append(entries.value(segments[i].wordsKeys[j]));
+            }
+        }
+        result.append(annotated);
+    }
+    return result;
+}
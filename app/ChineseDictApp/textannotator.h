@@ -0,0 +1,55 @@
+/*
+ * Copyright Justin Armstrong 2012, 2018.
+ *
+ * This file is part of the application "Chinese-English Dictionary for Qt"
+ *
+ * "Chinese-English Dictionary for Qt" is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef TEXTANNOTATOR_H
+#define TEXTANNOTATOR_H
+
+#include <QList>
+#include <QString>
+
+#include "batchlookup.h"
+#include "segmenter.h"
+
+//a word of annotated text with its pinyin, tone numbers and definitions
+//in entries, most common first. empty for text that isn't in the dictionary
+struct AnnotatedSegment {
+    QString text;
+    QList<LookupEntry> entries;
+};
+
+//runs chinese text through the dictionary: segments it into words
+//and looks up the entries for every word.
+//the segmenter is built from every headword when this is made,
+//after that it can be used from any thread
+class TextAnnotator
+{
+private:
+    Segmenter m_segmenter;
+    BatchLookup m_lookup;
+
+    bool loadHeadwords(const QString& dbPath);
+
+public:
+    explicit TextAnnotator(const QString& dbPath);
+
+    bool isOpen() const { return m_lookup.isOpen() && (m_segmenter.wordCount() > 0); }
+
+    //parallel segments large texts on the global thread pool
+    QList<AnnotatedSegment> annotate(const QString& text, bool parallel = false);
+};
+
+#endif // TEXTANNOTATOR_H
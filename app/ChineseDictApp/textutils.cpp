@@ -18,90 +18,241 @@
 #include <QDebug>
 #include <QRegularExpression>
 #include <QStringList>
+#include <QHash>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include <assert.h>
 #include "textutils.h"
+#include "pinyinsyllables.h"
+#include "logging.h"
 
 #define ARRAY_SIZE(arr) ((sizeof(arr))/(sizeof(arr[0])))
 
-//matches pinyin syllable + optional tone num (e.g. wei2)
-//static QRegularExpression s_pinyinSyllableRegExp(u8"([0-9]|[A-zÜü:]+)([1-5])?");
-static QRegularExpression s_pinyinSyllableRegExp(u8"([0-9]|[a-zA-Z\u00C0-\u024F:]+)([1-5])?");
-
-//matches pinyin syllable + required tone num
-static QRegularExpression s_pinyinSyllableNumRegExp(u8"([0-9]|[A-zÜü:]+)([1-5])+");
-
-//matches tonemarked pinyin
-static QRegularExpression s_toneMatchRegExp(u8"[āōēīūǖáóéíúǘǎǒěǐǔǚàòèìùǜĀŌĒĪŪǕÁÓÉÍÚǗǍǑĚǏǓǙÀÒÈÌÙǛ]+");
-//matches an actual hanzi character
-static QRegularExpression s_hanziMatchRegExp("\\p{Han}");
 static QRegularExpression s_toneNumMatchRegExp("[1-5]");
-static QRegularExpression s_punctuationRegExp("[,·、]");
 
-struct ToneMarkLocationMap_t {
-    QString str;
-    uint index;
+static constexpr wchar_t s_toneMarks[5][13] =
+{
+    L"aoeiuü" L"AOEIUÜ",  //src
+    L"āōēīūǖ" L"ĀŌĒĪŪǕ", //1st tone
+    L"áóéíúǘ" L"ÁÓÉÍÚǗ", //2nd tone
+    L"ǎǒěǐǔǚ" L"ǍǑĚǏǓǙ", //3rd tone
+    L"àòèìùǜ" L"ÀÒÈÌÙǛ"  //4th tone
+};
 
+struct ToneMarkIndex {
+    signed char index[256];
 };
 
-static ToneMarkLocationMap_t s_toneMarkLocationMaps[] =
-{
-
-    { QString::fromWCharArray(L"ai"), 0 }, //"a*i"
-    { QString::fromWCharArray(L"ao"), 0 }, //"a*o"
-    { QString::fromWCharArray(L"ei"), 0 }, //"e*i"
-    { QString::fromWCharArray(L"ou"), 0 }, //"o*u"
-    { QString::fromWCharArray(L"ia"), 1 }, //"ia*"
-    { QString::fromWCharArray(L"ie"), 1 }, //"ie*"
-    { QString::fromWCharArray(L"iu"), 1 }, //"iu*"
-    { QString::fromWCharArray(L"io"), 1 }, //"io*"
-    { QString::fromWCharArray(L"ua"), 1 }, //"ua*"
-    { QString::fromWCharArray(L"ue"), 1 }, //"ue*"
-    { QString::fromWCharArray(L"ui"), 1 }, //"ui*"
-    { QString::fromWCharArray(L"uo"), 1 }, //"uo*"
-    { QString::fromWCharArray(L"üe"), 1 }, //"üe*"
-    { QString::fromWCharArray(L"a"),  0 },
-    { QString::fromWCharArray(L"e"),  0 },
-    { QString::fromWCharArray(L"i"),  0 },
-    { QString::fromWCharArray(L"o"),  0 },
-    { QString::fromWCharArray(L"u"),  0 },
-    { QString::fromWCharArray(L"ü"),  0 }
+//the column of s_toneMarks for each unmarked vowel, all of which are
+//below 0x100, or -1
+static constexpr ToneMarkIndex buildToneMarkIndex()
+{
+    ToneMarkIndex toneMarkIndex = {};
+    int i = 0;
+    for (i=0; i < 256; i++) toneMarkIndex.index[i] = -1;
+    for (i=0; s_toneMarks[0][i] != 0; i++) toneMarkIndex.index[s_toneMarks[0][i]] = i;
+    return toneMarkIndex;
+}
+
+static constexpr ToneMarkIndex s_toneMarkIndex = buildToneMarkIndex();
+
+//the classes of one code point, worked out from scratch
+static uint computeCharClass(uint ucs4)
+{
+    uint classes = 0;
+    if (QChar::script(ucs4) == QChar::Script_Han) classes |= ccHan;
+    if (((ucs4 >= 'a') && (ucs4 <= 'z')) || ((ucs4 >= 'A') && (ucs4 <= 'Z'))) classes |= ccLatinLetter;
+    if ((ucs4 == 0x00FC) || (ucs4 == 0x00DC)) classes |= ccUmlautU;    //ü Ü
+    if ((ucs4 >= '1') && (ucs4 <= '5')) classes |= ccToneDigit;
+    if ((ucs4 == ',') || (ucs4 == 0x00B7) || (ucs4 == 0x3001)) classes |= ccPunctuation;   //, · 、
+    uint tone;
+    for (tone=1; tone < ARRAY_SIZE(s_toneMarks); tone++) {
+        uint i;
+        for (i=0; s_toneMarks[tone][i] != 0; i++) {
+            if ((uint)s_toneMarks[tone][i] == ucs4) classes |= ccToneMarkedVowel;
+        }
+    }
+    return classes;
+}
+
+//the classes of every BMP code point, as 256 blocks of 256 bytes.
+//most blocks are identical (all Han, or nothing at all) so they are
+//stored once, which keeps the table to a few KB
+class CharClassTable
+{
+private:
+    quint8 m_blockIndex[256];
+    QByteArray m_blocks;
+
+public:
+    CharClassTable()
+    {
+        QHash<QByteArray, int> seen;
+        int block;
+        for (block=0; block < 256; block++) {
+            QByteArray classes(256, 0);
+            int i;
+            for (i=0; i < 256; i++) {
+                classes[i] = (char)computeCharClass((block << 8) | i);
+            }
+            int index = seen.value(classes, -1);
+            if (index < 0) {
+                index = seen.count();
+                seen.insert(classes, index);
+                m_blocks.append(classes);
+            }
+            m_blockIndex[block] = (quint8)index;
+        }
+    }
+
+    inline uint lookup(ushort c) const
+    {
+        return (uchar)m_blocks.constData()[(m_blockIndex[c >> 8] << 8) | (c & 0xFF)];
+    }
 
+    int byteSize() const { return sizeof(m_blockIndex) + m_blocks.size(); }
 };
 
+//built on first use. a function static, so that is thread safe
+static const CharClassTable& charClassTable()
+{
+    static const CharClassTable table;
+    return table;
+}
 
+uint classifyChar(uint ucs4)
+{
+    //outside the BMP only Han is of interest, and it is rare enough to look up directly
+    if (ucs4 < 0x10000) return charClassTable().lookup((ushort)ucs4);
+    return computeCharClass(ucs4);
+}
 
-static wchar_t s_toneMarks[5][13] =
+//adds the classes of the code point at text[i], returning how many units it took
+static inline int classifyAt(const CharClassTable& table, const ushort* text, int i, int length, uint& classes)
 {
-    L"aoeiuü" L"AOEIUÜ",  //src
-    L"āōēīūǖ" L"ĀŌĒĪŪǕ", //1st tone
-    L"áóéíúǘ" L"ÁÓÉÍÚǗ", //2nd tone
-    L"ǎǒěǐǔǚ" L"ǍǑĚǏǓǙ", //3rd tone
-    L"àòèìùǜ" L"ÀÒÈÌÙǛ"  //4th tone
-};
+    ushort c = text[i];
+    if (QChar::isHighSurrogate(c) && (i + 1 < length) && QChar::isLowSurrogate(text[i + 1])) {
+        classes |= computeCharClass(QChar::surrogateToUcs4(c, text[i + 1]));
+        return 2;
+    }
+    classes |= table.lookup(c);
+    return 1;
+}
+
+uint classifyText(const QChar* text, int length)
+{
+    const CharClassTable& table = charClassTable();
+    const ushort* units = reinterpret_cast<const ushort*>(text);
+    uint classes = 0;
+    int i = 0;
+
+#ifdef __SSE2__
+    //8 units at a time. a block of plain ascii is classified with compares,
+    //anything else goes through the table one unit at a time
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i nonAscii = _mm_set1_epi16((short)0xFF80);
+    const __m128i caseBit = _mm_set1_epi16(0x20);
+    const __m128i beforeA = _mm_set1_epi16('a' - 1);
+    const __m128i afterZ = _mm_set1_epi16('z' + 1);
+    const __m128i before1 = _mm_set1_epi16('1' - 1);
+    const __m128i after5 = _mm_set1_epi16('5' + 1);
+    const __m128i comma = _mm_set1_epi16(',');
+    while (i + 8 <= length) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(units + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, nonAscii), zero)) == 0xFFFF) {
+            __m128i lower = _mm_or_si128(v, caseBit);
+            __m128i letters = _mm_and_si128(_mm_cmpgt_epi16(lower, beforeA), _mm_cmplt_epi16(lower, afterZ));
+            __m128i digits = _mm_and_si128(_mm_cmpgt_epi16(v, before1), _mm_cmplt_epi16(v, after5));
+            if (_mm_movemask_epi8(letters)) classes |= ccLatinLetter;
+            if (_mm_movemask_epi8(digits)) classes |= ccToneDigit;
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(v, comma))) classes |= ccPunctuation;
+            i += 8;
+        } else {
+            int end = i + 8;
+            while (i < end) i += classifyAt(table, units, i, length, classes);
+        }
+    }
+#endif
+
+    while (i < length) i += classifyAt(table, units, i, length, classes);
+    return classes;
+}
+
+int charClassTableSize()
+{
+    return charClassTable().byteSize();
+}
 
 bool isHanzi(const QString& text)
 {
-    return s_hanziMatchRegExp.match(text).hasMatch();
+    return (classifyText(text) & ccHan) != 0;
 }
 
 bool isPunctuation(const QString& text)
 {
-   return s_punctuationRegExp.match(text).hasMatch();
+    return (classifyText(text) & ccPunctuation) != 0;
+}
+
+//a tone number straight after a syllable, as the regex
+//([0-9]|[A-zÜü:]+)([1-5])+ would find, e.g. "zhong1"
+static bool _hasNumberedSyllable(const QString& text)
+{
+    int i;
+    for (i=1; i < text.length(); i++) {
+        ushort c = text.at(i).unicode();
+        ushort previous = text.at(i-1).unicode();
+        if ((c >= '1') && (c <= '5') &&
+            (((previous >= '0') && (previous <= '9')) || ((previous >= 'A') && (previous <= 'z')) ||
+             (previous == 0x00DC) || (previous == 0x00FC) || (previous == ':'))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//a run of two or more consonants only, e.g. "zg", typed as syllable initials.
+//spaces may be around it but not in it, "x x s" is syllables that have only
+//been started, see splitTonelessSyllables()
+static bool _isPinyinInitials(const QString& text)
+{
+    int start = 0;
+    int end = text.length();
+    while ((start < end) && (text.at(start) == QChar(' '))) start++;
+    while ((end > start) && (text.at(end - 1) == QChar(' '))) end--;
+    if (end - start < 2) return false;
+    int i;
+    for (i=start; i < end; i++) {
+        ushort c = text.at(i).unicode();
+        if ((c >= 'A') && (c <= 'Z')) c += 'a' - 'A';
+        if ((c < 'a') || (c > 'z')) return false;
+        if ((c == 'a') || (c == 'e') || (c == 'i') || (c == 'o') || (c == 'u')) return false;
+    }
+    return true;
 }
 
 textFormat_t determineTextFormat(const QString& text)
 {
     //qDebug() << text;
-    if (isHanzi(text)) {
+    uint classes = classifyText(text);
+    if (classes & ccHan) {
+        if (classes & ccLatinLetter) {
+            //qDebug() << "is apparently hanzi mixed with pinyin";
+            return tfMixed;
+        }
         //qDebug() << "is apparently hanzi";
         return tfHanzi;
-    } else if (s_toneMatchRegExp.match(text, QRegularExpression::CaseInsensitiveOption).hasMatch()) {
+    } else if (classes & ccToneMarkedVowel) {
         //qDebug() << "is apparently tonemarked";
         return tfPinyinTonemarks;
-    } else if (s_pinyinSyllableNumRegExp.match(text).hasMatch()) {
+    } else if ((classes & ccToneDigit) && _hasNumberedSyllable(text)) {
         //qDebug() << "is apparently numbered";
         return tfPinyinNumbers;
+    } else if ((classes == ccLatinLetter) && _isPinyinInitials(text)) {
+        //qDebug() << "is apparently pinyin initials";
+        return tfPinyinInitials;
     } else {
         //qDebug() << "is apparently unnumbered pinyin";
         return tfPinyinNoTones;
@@ -109,6 +260,26 @@ textFormat_t determineTextFormat(const QString& text)
 }
 
 
+//normalises a headword or pinyin string to match the keys dbcreator writes
+//to headword_keys: hanzi as they are, pinyin lowercase without spaces,
+//and tone numbers turned into tone marks.
+//e.g. "zhong1 guo2" -> "zhōngguó", "Zhong guo" -> "zhongguo", "nǚ'ér" -> "nǚér"
+QString makeLookupKey(const QString& text)
+{
+    QString key = text.trimmed();
+    switch (determineTextFormat(key)) {
+    case tfHanzi:
+    case tfMixed:
+        return key;
+    case tfPinyinNumbers:
+        return makeToneMarkedSearchPinyin(key.toLower().remove(' '));
+    case tfPinyinTonemarks:
+        return key.toLower().remove(' ').remove('\'');
+    default:
+        return makeTonelessSearchPinyin(key.toLower().remove(' '));
+    }
+}
+
 
 /*
 QList<int> getToneNumbersFromMarkedString(const QString& toneMarked)
@@ -132,169 +303,742 @@ QList<int> getToneNumbersFromMarkedString(const QString& toneMarked)
 */
 
 
-static void _insertToneMark(QString& syllable, int toneNum)
+static void _insertToneMark(QChar* syllable, int length, int toneNum)
 {
     if ((toneNum > 0) && (toneNum < 5)) { //got a useful tone number
         //now find where we should put the tone mark
-        int markPos = -1;
-        uint i;
-        ToneMarkLocationMap_t* locMap;
-        QString lower = syllable.toLower();
-        for (i=0; (i < ARRAY_SIZE(s_toneMarkLocationMaps)) && (markPos < 0); i++) {
-            locMap = &s_toneMarkLocationMaps[i];
-            markPos = lower.indexOf(locMap->str, Qt::CaseInsensitive);
-            //qDebug() << "looking for " << locMap->str << " in " << syllable << ", found? " << markPos;
-        }
+        int markPos = findToneMarkPosition(syllable, length);
 
         //replace the char at markPos with a marked one
         if (markPos > -1) {
-            //find the replacement char
-            wchar_t srcChar = syllable.at(markPos + locMap->index).unicode();
-            int toneMarkIndex = -1;
-            for (i=0; i < ARRAY_SIZE(s_toneMarks[0]); i++) {
-                if (s_toneMarks[0][i] == srcChar) {
-                    toneMarkIndex = i;
-                    break;
-                }
-            }
+            ushort srcChar = syllable[markPos].unicode();
+            int toneMarkIndex = (srcChar < 256) ? s_toneMarkIndex.index[srcChar] : -1;
             Q_ASSERT(toneMarkIndex != -1);
-            wchar_t toneMarkChar = s_toneMarks[toneNum][toneMarkIndex];
-
-            //qDebug() << "replacing " << QChar(srcChar) << " with " << QChar(toneMarkChar) << " at " << toneMarkIndex;
-            syllable.replace(markPos + locMap->index, 1, QChar(toneMarkChar));
+            if (toneMarkIndex != -1) syllable[markPos] = QChar((ushort)s_toneMarks[toneNum][toneMarkIndex]);
         }
     } //toneNum between 1 and 5
 }
 
-static QString _makeSearchPinyin(const QString& words, bool withToneMarks)
+//appends c lowercased, as QString::toLower() would
+static inline void _appendLower(QChar c, QString& out)
 {
+    ushort u = c.unicode();
+    if (u < 0x80) {
+        if ((u >= 'A') && (u <= 'Z')) u += 'a' - 'A';
+        out.append(QChar(u));
+    } else if (u == 0x0130) {
+        //the one character whose lowercase is two: İ -> i̇
+        out.append(QChar('i'));
+        out.append(QChar(0x0307));
+    } else {
+        out.append(c.toLower());
+    }
+}
 
-    QString cleaned = words;
-    //qDebug() << "_makeSearchPinyin: " << cleaned << (withToneMarks ? "(with tonemarks)" : "(no tonemarks)");
-    QString result;
+static void _appendLower(const QChar* text, int length, bool umlautToU, QString& out)
+{
+    int i;
+    for (i=0; i < length; i++) {
+        int end = out.length();
+        _appendLower(text[i], out);
+        //the non-tonemarked search treats ü and u identically
+        if (umlautToU && (out.at(end) == QChar(L'ü'))) out[end] = QChar('u');
+    }
+}
 
-    QRegularExpressionMatchIterator matches = s_pinyinSyllableRegExp.globalMatch(cleaned);
-    while (matches.hasNext()) {
-        QRegularExpressionMatch match = matches.next();
-        QString syllable;
-        int toneNum = 5;
-        //qDebug() << "match.lastCapturedIndex() " << match.lastCapturedIndex();
-        if (match.lastCapturedIndex() > 1) {
-            QString toneNumStr = match.captured(2);
-            toneNum = toneNumStr.at(0).digitValue();
-        }
-        syllable = match.captured(1).toLower();
-        syllable.replace(QString("u:"), QChar(L'ü'));
-        if (syllable.length() > 1) {
-            //if single character, might actually be matching 'V' e.g. VCR
-            syllable.replace(QString("v"), QChar(L'ü'));
+//the characters a search syllable is made of: [a-zA-Z\u00C0-\u024F:]
+static inline bool _isSearchPinyinChar(ushort c)
+{
+    return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) ||
+           ((c >= 0x00C0) && (c <= 0x024F)) || (c == ':');
+}
+
+static void _appendSearchSyllable(const QChar* syllable, int length, int toneNum, bool withToneMarks, QString& out)
+{
+    int start = out.length();
+    int i;
+    for (i=0; i < length; i++) {
+        if ((syllable[i] == QChar(':')) && (out.length() > start) && (out.at(out.length() - 1) == QChar('u'))) {
+            out[out.length() - 1] = QChar(L'ü');
+        } else {
+            _appendLower(syllable[i], out);
         }
-        if (!withToneMarks){
-            //the non-tonemarked search treats ü and u identically,
-            //so we need to replace all ü with u!
-            syllable.replace(QString::fromWCharArray(L"ü"), QChar('u'));
+    }
+
+    QChar* tail = out.data() + start;
+    int tailLength = out.length() - start;
+    for (i=0; i < tailLength; i++) {
+        //if single character, might actually be matching 'V' e.g. VCR
+        if ((tail[i] == QChar('v')) && (tailLength > 1)) tail[i] = QChar(L'ü');
+        //the non-tonemarked search treats ü and u identically,
+        //so we need to replace all ü with u!
+        if ((tail[i] == QChar(L'ü')) && !withToneMarks) tail[i] = QChar('u');
+    }
+    if (withToneMarks) _insertToneMark(tail, tailLength, toneNum);
+}
+
+//splits words as the regex ([0-9]|[a-zA-Z\u00C0-\u024F:]+)([1-5])? would,
+//each syllable being a single digit or a run of letters with an optional
+//tone number (e.g. wei2), and appends them converted
+static void _appendSearchPinyin(const QChar* words, int length, bool withToneMarks, QString& out)
+{
+    int i = 0;
+    while (i < length) {
+        ushort c = words[i].unicode();
+        int start = i;
+        if ((c >= '0') && (c <= '9')) {
+            i++;
+        } else if (_isSearchPinyinChar(c)) {
+            while ((i < length) && _isSearchPinyinChar(words[i].unicode())) i++;
+        } else {
+            i++;
+            continue;
         }
-        if (withToneMarks) _insertToneMark(syllable, toneNum);
-        //qDebug() << syllable << ":" << toneNum;
+        int end = i;
 
-        result += syllable;
+        int toneNum = 5;
+        if ((i < length) && (words[i].unicode() >= '1') && (words[i].unicode() <= '5')) {
+            toneNum = words[i].unicode() - '0';
+            i++;
+        }
+        _appendSearchSyllable(words + start, end - start, toneNum, withToneMarks, out);
     }
+}
 
-    //qDebug() << "made: " << result;
-    return result;
+void appendTonelessSearchPinyin(const QChar* words, int length, QString& out)
+{
+    _appendSearchPinyin(words, length, false, out);
 }
 
+void appendToneMarkedSearchPinyin(const QChar* words, int length, QString& out)
+{
+    _appendSearchPinyin(words, length, true, out);
+}
 
 QString makeTonelessSearchPinyin(const QString& words)
 {
-    return _makeSearchPinyin(words, false);
+    QString result;
+    appendTonelessSearchPinyin(words.constData(), words.length(), result);
+    return result;
 }
 
 QString makeToneMarkedSearchPinyin(const QString& words)
 {
-     return _makeSearchPinyin(words, true);
+    QString result;
+    appendToneMarkedSearchPinyin(words.constData(), words.length(), result);
+    return result;
 }
 
+void clearBuffer(QString& buffer)
+{
+    //resize(0) on its own may free it, unless the capacity is reserved
+    buffer.reserve(buffer.capacity());
+    buffer.resize(0);
+}
 
-void parseCedictEntry(const QString& source, //input
-                      QString& displayPinyin,           //out
-                      QString& tonemarkedSearchPinyin,  //out
-                      QString& tonelessSearchPinyin,    //out
-                      QString& toneNums,                //out
-                      QString& componentPinyin)         //out
+void setUtf8(const QChar* text, int length, QByteArray& out)
 {
-    qDebug() << "parseCedictEntry: " << source;
+    out.reserve(qMax(out.capacity(), length * 3));
+    out.resize(length * 3);
+    uchar* start = reinterpret_cast<uchar*>(out.data());
+    uchar* p = start;
+    int i;
+    for (i=0; i < length; i++) {
+        uint c = text[i].unicode();
+        if (c < 0x80) {
+            *p++ = (uchar)c;
+            continue;
+        }
+        if (QChar::isHighSurrogate(c) && (i + 1 < length) && text[i + 1].isLowSurrogate()) {
+            c = QChar::surrogateToUcs4((ushort)c, text[++i].unicode());
+            *p++ = (uchar)(0xF0 | (c >> 18));
+            *p++ = (uchar)(0x80 | ((c >> 12) & 0x3F));
+        } else {
+            //a lone surrogate becomes U+FFFD, as QString::toUtf8() makes it
+            if (QChar::isSurrogate(c)) c = QChar::ReplacementCharacter;
+            if (c < 0x800) {
+                *p++ = (uchar)(0xC0 | (c >> 6));
+                *p++ = (uchar)(0x80 | (c & 0x3F));
+                continue;
+            }
+            *p++ = (uchar)(0xE0 | (c >> 12));
+        }
+        *p++ = (uchar)(0x80 | ((c >> 6) & 0x3F));
+        *p++ = (uchar)(0x80 | (c & 0x3F));
+    }
+    out.resize(p - start);
+}
 
-    QString cleaned = source;
-    displayPinyin.clear();
-    tonemarkedSearchPinyin.clear();
-    tonelessSearchPinyin.clear();
-    toneNums.clear();
-    componentPinyin.clear();
-    QStringListIterator iterator = QStringListIterator(cleaned.split(" "));
-    while (iterator.hasNext()) {
-        QString syllable = iterator.next();
-        //qDebug() << "syllable: " << syllable;
+//spaces and ' are the syllable boundaries a user types, e.g. "zhong guo", "xi'an"
+static inline bool _isSyllableSeparator(QChar c)
+{
+    return (c == QChar('\'')) || c.isSpace();
+}
 
-        int toneNum = 5;
-        if (syllable.length() > 1) {
-            int digit = syllable.at(syllable.length()-1).digitValue();
-            if ((digit >= 1) && (digit <= 5)) {
-                toneNum = digit;
-                syllable.chop(1); //remove number
+//appends the toneless syllables of words, each followed by suffix and with
+//separator between them, returning how many there were.
+//words is split where spaces or ' were typed, and then by segmentPinyin().
+//a piece that isn't pinyin is one syllable, and partial syllables are kept
+static int _appendTonelessSyllables(const QChar* words, int length, QLatin1String separator,
+                                    QLatin1String suffix, QString& out)
+{
+    int count = 0;
+    int pieceStart = 0;
+    while (pieceStart < length) {
+        int pieceEnd = pieceStart;
+        while ((pieceEnd < length) && !_isSyllableSeparator(words[pieceEnd])) pieceEnd++;
+        PinyinSegmentation segmentation;
+        int found = segmentPinyin(words + pieceStart, pieceEnd - pieceStart, &segmentation, 1);
+        int i;
+        for (i=0; i < (found ? segmentation.count : 1); i++) {
+            int start = out.length();
+            if (count > 0) out += separator;
+            int syllableStart = out.length();
+            if (found) {
+                const PinyinSyllable& syllable = segmentation.syllables[i];
+                _appendSearchSyllable(words + pieceStart + syllable.start, syllable.length, 5, false, out);
+            } else {
+                _appendSearchPinyin(words + pieceStart, pieceEnd - pieceStart, false, out);
+            }
+            if (out.length() == syllableStart) {
+                out.truncate(start);
+                continue;
             }
+            out += suffix;
+            count++;
         }
+        pieceStart = pieceEnd + 1;
+    }
+    return count;
+}
 
-        syllable.replace(QString("u:"), QChar(L'ü')).replace(QString("U:"), QChar(L'Ü'));
-        if (syllable.length() > 1) {
-            //if single character, might actually be matching 'V' e.g. VCR
-            syllable.replace(QString("v"), QChar(L'ü')).replace(QString("V"), QChar(L'Ü'));
+//folds the toneless syllable at the end of out, from start on
+static void _foldFuzzySyllable(QString& out, int start)
+{
+    int length = out.length() - start;
+    if (length == 0) return;
+    QChar first = out.at(start);
+    if ((length > 1) && (out.at(start + 1) == QChar('h')) &&
+        ((first == QChar('z')) || (first == QChar('c')) || (first == QChar('s')))) {
+        out.remove(start + 1, 1);
+        length--;
+    } else if (first == QChar('l')) {
+        out[start] = QChar('n');
+    }
+    if ((length > 1) && out.endsWith(QLatin1String("ng"))) out.chop(1);
+}
+
+//toneless pinyin with the commonly confused sounds folded together:
+//zh/z, ch/c, sh/s, n/l, an/ang, en/eng and in/ing.
+//each syllable is folded on its own, so a fold never reaches into the next
+//one. syllables are split where spaces, ' or tone digits were typed, and
+//by segmentPinyin() within a run, and a run that isn't pinyin is folded whole.
+//e.g. "zhong guo" and "zongguo" both become "zonguo", but "ban guo" is
+//"banguo" and "ba nuo" is "banuo"
+void appendFuzzySearchPinyin(const QChar* toneless, int length, QString& out)
+{
+    int pieceStart = 0;
+    while (pieceStart < length) {
+        int pieceEnd = pieceStart;
+        while ((pieceEnd < length) && !_isSyllableSeparator(toneless[pieceEnd])) pieceEnd++;
+        PinyinSegmentation segmentation;
+        if (segmentPinyin(toneless + pieceStart, pieceEnd - pieceStart, &segmentation, 1) == 0) {
+            int start = out.length();
+            _appendSearchPinyin(toneless + pieceStart, pieceEnd - pieceStart, false, out);
+            _foldFuzzySyllable(out, start);
+        } else {
+            int i;
+            for (i=0; i < segmentation.count; i++) {
+                const PinyinSyllable& syllable = segmentation.syllables[i];
+                int start = out.length();
+                _appendSearchSyllable(toneless + pieceStart + syllable.start, syllable.length, 5, false, out);
+                _foldFuzzySyllable(out, start);
+            }
         }
-        QString tonemarkedSyllable = syllable;
-        _insertToneMark(tonemarkedSyllable, toneNum);
+        pieceStart = pieceEnd + 1;
+    }
+}
 
-        QString tonelessSyllable = syllable.toLower();
-        //the non-tonemarked search treats ü and u identically,
-        //so we need to replace all ü with u!
-        tonelessSyllable.replace(QString::fromWCharArray(L"ü"), QChar('u'));
+//e.g. "zhong1 guo2" and "zongguo" both become "zonguo"
+QString makeFuzzySearchPinyin(const QString& words)
+{
+    QString result;
+    appendFuzzySearchPinyin(words.constData(), words.length(), result);
+    return result;
+}
 
-        if (syllable == "·") {
-            //qDebug() << "appending dot";
-            displayPinyin += " ·";
-        } else if (syllable == ",") {
-            displayPinyin += ",";
+void makePinyinSearchQueries(const QString& search, textFormat_t textFormat, bool withFuzzy,
+                             PinyinSearchQueries& queries)
+{
+    clearBuffer(queries.text);
+    clearBuffer(queries.pinyin);
+    clearBuffer(queries.syllables);
+    clearBuffer(queries.fuzzy);
+
+    //lowercase, without spaces
+    int i;
+    for (i=0; i < search.length(); i++) {
+        if (search.at(i) != QChar(' ')) _appendLower(search.at(i), queries.text);
+    }
+    const QChar* text = queries.text.constData();
+    int length = queries.text.length();
+
+    if (textFormat == tfPinyinInitials) {
+        queries.pinyin.append(text, length);
+        queries.pinyin += QChar('*');
+    } else if (textFormat == tfPinyinNoTones) {
+        appendTonelessSearchPinyin(text, length, queries.pinyin);
+        //from the search as typed, so its spaces still mark syllables
+        queries.syllables += QLatin1String("\"^");
+        if (_appendTonelessSyllables(search.constData(), search.length(), QLatin1String(" "),
+                                     QLatin1String("*"), queries.syllables) > 1) {
+            queries.syllables += QChar('"');
         } else {
-            //single character items are numbers or letter of acronyms, so don't put spaces between them
-            if ((syllable.length() > 1) && (!displayPinyin.isEmpty())) {
-                displayPinyin += " ";
-            }
-            displayPinyin += tonemarkedSyllable;
-            tonemarkedSearchPinyin += tonemarkedSyllable.toLower();
-            tonelessSearchPinyin += tonelessSyllable;
-
-            toneNums += QString::number(toneNum);
-            componentPinyin += tonemarkedSyllable.toLower();
-            if (iterator.hasNext()) {
-                toneNums += ",";
-                componentPinyin += ",";
-            }
+            queries.syllables.resize(0);
+        }
+        if (withFuzzy) appendFuzzySearchPinyin(search.constData(), search.length(), queries.fuzzy);
+    } else if (textFormat == tfPinyinNumbers) {
+        appendToneMarkedSearchPinyin(text, length, queries.pinyin);
+    } else {
+        //already tonemarked
+        queries.pinyin.append(text, length);
+    }
+}
+
+
+//c lowercased without any tone mark or umlaut, as decomposing it and
+//dropping the combining marks would. the pinyin vowels are looked up in
+//s_toneMarks, anything else that isn't ascii is rare enough to decompose
+static QChar _baseLetter(QChar c)
+{
+    ushort u = c.unicode();
+    if (u < 0x80) return ((u >= 'A') && (u <= 'Z')) ? QChar((ushort)(u + 'a' - 'A')) : c;
+    uint tone;
+    for (tone=0; tone < ARRAY_SIZE(s_toneMarks); tone++) {
+        uint i;
+        for (i=0; s_toneMarks[tone][i] != 0; i++) {
+            if ((ushort)s_toneMarks[tone][i] != u) continue;
+            QChar base((ushort)s_toneMarks[0][i]);
+            if ((base == QChar(L'ü')) || (base == QChar(L'Ü'))) return QChar('u');
+            return base.toLower();
+        }
+    }
+    return QString(c).normalized(QString::NormalizationForm_D).at(0).toLower();
+}
+
+void appendInitialsSearchPinyin(const QChar* componentPinyin, int length, QString& out)
+{
+    int i;
+    for (i=0; i < length; i++) {
+        if ((componentPinyin[i] != QChar(',')) && ((i == 0) || (componentPinyin[i-1] == QChar(',')))) {
+            out += _baseLetter(componentPinyin[i]);
+        }
+    }
+}
+
+//first letter of each syllable, with any tone mark removed.
+//takes the comma separated component pinyin made by parseCedictEntry()
+//e.g. "zhōng,guó" -> "zg", "xué,xí,shēng,huó" -> "xxsh"
+QString makeInitialsSearchPinyin(const QString& componentPinyin)
+{
+    QString result;
+    appendInitialsSearchPinyin(componentPinyin.constData(), componentPinyin.length(), result);
+    return result;
+}
+
+void appendSyllableSearchPinyin(const QChar* componentPinyin, int length, QString& out)
+{
+    int start = out.length();
+    int i;
+    for (i=0; i < length; i++) {
+        QChar c = componentPinyin[i];
+        if (c == QChar(',')) continue;
+        if (c.category() == QChar::Mark_NonSpacing) continue; //a combining tone mark or umlaut
+        if ((out.length() > start) && (componentPinyin[i-1] == QChar(','))) out += QChar(' ');
+        out += _baseLetter(c);
+    }
+}
+
+//space separated toneless syllables, one per entry in the component pinyin.
+//ü is treated as u, as in the other toneless columns
+//e.g. "zhōng,guó" -> "zhong guo", "lǜ,sè" -> "lu se"
+QString makeSyllableSearchPinyin(const QString& componentPinyin)
+{
+    QString result;
+    appendSyllableSearchPinyin(componentPinyin.constData(), componentPinyin.length(), result);
+    return result;
+}
+
+//splits search input on the syllable boundaries the user typed,
+//making each piece toneless. pieces typed run together are split further
+//in the most likely way, if they are pinyin at all.
+//partial syllables are left as they are
+//e.g. "zhong g" -> ("zhong", "g"), "Xi'an" -> ("xi", "an"), "huaren" -> ("hua", "ren")
+QStringList splitTonelessSyllables(const QString& words)
+{
+    QString syllables;
+    _appendTonelessSyllables(words.constData(), words.length(), QLatin1String(" "), QLatin1String(""), syllables);
+    return syllables.split(' ', QString::SkipEmptyParts);
+}
+
+void appendHanziSyllableSearchText(const QChar* hanzi, int hanziLength,
+                                   const QChar* syllables, int syllablesLength, QString& out)
+{
+    int start = out.length();
+    int syllableStart = 0;
+    int i;
+    for (i=0; i < hanziLength; i++) {
+        //punctuation in the headword has no syllable of its own
+        if (!hanzi[i].isLetterOrNumber()) continue;
+        while ((syllableStart < syllablesLength) && (syllables[syllableStart] == QChar(' '))) syllableStart++;
+        if (syllableStart == syllablesLength) break;
+        int syllableEnd = syllableStart;
+        while ((syllableEnd < syllablesLength) && (syllables[syllableEnd] != QChar(' '))) syllableEnd++;
+        if (out.length() > start) out += QChar(' ');
+        out.append(syllables + syllableStart, syllableEnd - syllableStart);
+        out += hanzi[i];
+        syllableStart = syllableEnd;
+    }
+}
+
+//pairs each character of a headword with its toneless syllable, syllable first,
+//so that a prefix query on the syllable alone still matches.
+//e.g. "中国", "zhōng,guó" -> "zhong中 guo国"
+QString makeHanziSyllableSearchText(const QString& hanzi, const QString& componentPinyin)
+{
+    QString syllables = makeSyllableSearchPinyin(componentPinyin);
+    QString result;
+    appendHanziSyllableSearchText(hanzi.constData(), hanzi.length(), syllables.constData(), syllables.length(), result);
+    return result;
+}
+
+//splits a search containing both hanzi and pinyin into one item per position:
+//each hanzi on its own, and each typed pinyin syllable made toneless.
+//e.g. "中guo" -> ("中", "guo"), "zhong 国" -> ("zhong", "国")
+QStringList splitMixedSearchText(const QString& text)
+{
+    QStringList result;
+    QString pinyinRun;
+    int i;
+    for (i=0; i < text.length(); i++) {
+        QString c = text.at(i);
+        if (classifyChar(text.at(i).unicode()) & ccHan) {
+            result.append(splitTonelessSyllables(pinyinRun));
+            pinyinRun.clear();
+            result.append(c);
+        } else {
+            pinyinRun += c;
+        }
+    }
+    result.append(splitTonelessSyllables(pinyinRun));
+    return result;
+}
+
+//splits english into lowercase terms for the english search index.
+//anything other than a letter or digit is a separator, as are hanzi,
+//e.g. "to run (of a machine)" -> ("to", "run", "of", "a", "machine")
+QStringList tokenizeEnglish(const QString& text)
+{
+    QStringList terms;
+    QString term;
+    int i;
+    for (i=0; i < text.length(); i++) {
+        QChar c = text.at(i);
+        if (c.isLetterOrNumber() && (c.script() != QChar::Script_Han)) {
+            term += c.toLower();
+        } else if (!term.isEmpty()) {
+            terms.append(term);
+            term.clear();
+        }
+    }
+    if (!term.isEmpty()) terms.append(term);
+    return terms;
+}
+
+//irregular english forms that suffix stripping can't handle, mapped to their base form.
+//forms that are also a common word of their own are left out, e.g. "rose",
+//"left", "saw", "found", "felt", "spoke", or searching for them would bring
+//up the verb's entries too
+static const char* s_irregularEnglish[][2] =
+{
+    { "ran", "run" }, { "went", "go" }, { "gone", "go" }, { "was", "be" }, { "were", "be" },
+    { "been", "be" }, { "is", "be" }, { "are", "be" }, { "am", "be" }, { "had", "have" },
+    { "has", "have" }, { "did", "do" }, { "done", "do" }, { "does", "do" }, { "made", "make" },
+    { "took", "take" }, { "taken", "take" }, { "gave", "give" }, { "given", "give" },
+    { "seen", "see" }, { "ate", "eat" }, { "eaten", "eat" }, { "wrote", "write" },
+    { "written", "write" }, { "spoken", "speak" }, { "came", "come" }, { "got", "get" },
+    { "gotten", "get" }, { "knew", "know" }, { "known", "know" }, { "bought", "buy" },
+    { "brought", "bring" }, { "caught", "catch" }, { "taught", "teach" }, { "kept", "keep" },
+    { "lost", "lose" }, { "met", "meet" }, { "paid", "pay" }, { "said", "say" },
+    { "sold", "sell" }, { "sent", "send" }, { "sat", "sit" }, { "stood", "stand" },
+    { "told", "tell" }, { "began", "begin" }, { "begun", "begin" }, { "broken", "break" },
+    { "chose", "choose" }, { "chosen", "choose" }, { "drank", "drink" }, { "drove", "drive" },
+    { "driven", "drive" }, { "fallen", "fall" }, { "flew", "fly" }, { "flown", "fly" },
+    { "forgot", "forget" }, { "forgotten", "forget" }, { "froze", "freeze" },
+    { "frozen", "freeze" }, { "grew", "grow" }, { "grown", "grow" }, { "hid", "hide" },
+    { "hidden", "hide" }, { "rode", "ride" }, { "ridden", "ride" }, { "rang", "ring" },
+    { "risen", "rise" }, { "sang", "sing" }, { "sung", "sing" }, { "sank", "sink" },
+    { "sunk", "sink" }, { "slept", "sleep" }, { "spent", "spend" }, { "swam", "swim" },
+    { "swum", "swim" }, { "threw", "throw" }, { "thrown", "throw" }, { "wore", "wear" },
+    { "worn", "wear" }, { "built", "build" }, { "held", "hold" }, { "heard", "hear" },
+    { "meant", "mean" }, { "fought", "fight" }, { "children", "child" }, { "men", "man" },
+    { "women", "woman" }, { "feet", "foot" }, { "teeth", "tooth" }, { "mice", "mouse" },
+    { "geese", "goose" }
+};
+
+static QHash<QString, QString> _makeIrregularEnglishMap()
+{
+    QHash<QString, QString> map;
+    uint i;
+    for (i=0; i < ARRAY_SIZE(s_irregularEnglish); i++) {
+        map.insert(QString::fromLatin1(s_irregularEnglish[i][0]), QString::fromLatin1(s_irregularEnglish[i][1]));
+    }
+    return map;
+}
+
+static QHash<QString, QString> s_irregularEnglishMap = _makeIrregularEnglishMap();
+
+static bool _isConsonant(const QString& word, int i)
+{
+    QChar c = word.at(i);
+    if ((c == 'a') || (c == 'e') || (c == 'i') || (c == 'o') || (c == 'u')) return false;
+    //y is a vowel after a consonant, e.g. "fly"
+    if (c == 'y') return (i == 0) || !_isConsonant(word, i-1);
+    return true;
+}
+
+//the number of vowel-consonant sequences, as in the Porter stemmer
+//e.g. "run" -> 1, "agre" -> 1, "tree" -> 0
+static int _measure(const QString& stem)
+{
+    int measure = 0;
+    bool previousVowel = false;
+    int i;
+    for (i=0; i < stem.length(); i++) {
+        bool consonant = _isConsonant(stem, i);
+        if (consonant && previousVowel) measure++;
+        previousVowel = !consonant;
+    }
+    return measure;
+}
+
+static bool _containsVowel(const QString& stem)
+{
+    int i;
+    for (i=0; i < stem.length(); i++) {
+        if (!_isConsonant(stem, i)) return true;
+    }
+    return false;
+}
+
+//ends consonant-vowel-consonant, where the last is not w, x or y. e.g. "hop", "mak"
+static bool _endsCvc(const QString& stem)
+{
+    int n = stem.length();
+    if (n < 3) return false;
+    QChar last = stem.at(n-1);
+    if ((last == 'w') || (last == 'x') || (last == 'y')) return false;
+    return _isConsonant(stem, n-3) && !_isConsonant(stem, n-2) && _isConsonant(stem, n-1);
+}
+
+//reduces an english term from tokenizeEnglish() to a stem shared by its inflected forms,
+//e.g. "running", "runs" and "ran" all become "run".
+//a light version of the Porter stemmer's first step, plus a table of irregular forms
+QString stemEnglish(const QString& term)
+{
+    QHash<QString, QString>::const_iterator irregular = s_irregularEnglishMap.constFind(term);
+    if (irregular != s_irregularEnglishMap.constEnd()) return irregular.value();
+    if (term.length() < 3) return term;
+
+    QString word = term;
+
+    //plurals and third person, e.g. "books", "studies", "boxes"
+    if (word.endsWith("sses")) {
+        word.chop(2);
+    } else if (word.endsWith("ies")) {
+        if (word.length() > 4) {
+            word.chop(3);
+            word += 'y';
+        } else {
+            word.chop(1);
+        }
+    } else if (word.endsWith('s') && (word.length() > 3) &&
+               !word.endsWith("ss") && !word.endsWith("us") && !word.endsWith("is")) {
+        word.chop(1);
+    }
+
+    //past tense and participles, e.g. "agreed", "studied", "hoped", "running"
+    if (word.endsWith("eed")) {
+        if (_measure(word.left(word.length() - 3)) > 0) word.chop(1);
+    } else if (word.endsWith("ied")) {
+        if (word.length() > 4) {
+            word.chop(3);
+            word += 'y';
+        } else {
+            word.chop(1);
+        }
+    } else if ((word.endsWith("ed") && _containsVowel(word.left(word.length() - 2))) ||
+               (word.endsWith("ing") && _containsVowel(word.left(word.length() - 3)))) {
+        word.chop(word.endsWith("ed") ? 2 : 3);
+        int n = word.length();
+        if (word.endsWith("at") || word.endsWith("bl") || word.endsWith("iz")) {
+            word += 'e';
+        } else if ((n >= 2) && (word.at(n-1) == word.at(n-2)) && _isConsonant(word, n-1) &&
+                   (word.at(n-1) != 'l') && (word.at(n-1) != 's') && (word.at(n-1) != 'z')) {
+            word.chop(1);
+        } else if ((_measure(word) == 1) && _endsCvc(word)) {
+            word += 'e';    //"hoped" -> "hope"
+        } else if ((n == 2) && _isConsonant(word, 1)) {
+            word += 'e';    //"used" -> "use" rather than "us", but "doing" -> "do"
+        }
+    }
+
+    //final e, so that e.g. "boxe" from "boxes" matches "box".
+    //a stem that short would be another word, e.g. "use" -> "us"
+    if (word.endsWith('e') && (word.length() > 3)) {
+        QString stem = word.left(word.length() - 1);
+        int measure = _measure(stem);
+        if ((measure > 1) || ((measure == 1) && !_endsCvc(stem))) word = stem;
+    }
+    return word;
+}
+
+
+
+//one space separated item of cedict pinyin, e.g. "Ai4", "lu:4", "·" or "3".
+//nothing is appended to the optional outputs that are NULL
+static void _appendCedictSyllable(const QChar* syllable, int length, bool hasNext, int displayStart,
+                                  QString& displayPinyin,
+                                  QString* tonemarkedSearchPinyin,
+                                  QString* tonelessSearchPinyin,
+                                  QString* toneNums,
+                                  QString* componentPinyin)
+{
+    int toneNum = 5;
+    if (length > 1) {
+        int digit = syllable[length-1].digitValue();
+        if ((digit >= 1) && (digit <= 5)) {
+            toneNum = digit;
+            length--; //remove number
         }
+    }
+
+    if ((length == 1) && (syllable[0] == QChar(0x00B7))) {
+        //qDebug() << "appending dot";
+        displayPinyin += " ·";
+        return;
+    } else if ((length == 1) && (syllable[0] == QChar(','))) {
+        displayPinyin += ",";
+        return;
+    }
+
+    //u: and U: become ü and Ü
+    int i;
+    int umlautLength = length;
+    for (i=1; i < length; i++) {
+        if ((syllable[i] == QChar(':')) && ((syllable[i-1] == QChar('u')) || (syllable[i-1] == QChar('U')))) umlautLength--;
+    }
 
-    } // iterator
-    qDebug() << "displayPinyin:" << displayPinyin;
-    qDebug() << "tonemarkedSearchPinyin:" << tonemarkedSearchPinyin;
-    qDebug() << "tonelessSearchPinyin:" << tonelessSearchPinyin;
-    qDebug() << "toneNums:" << toneNums;
-    qDebug() << "componentPinyin:" << componentPinyin;
-    assert(toneNums.split(',').length() == componentPinyin.split(',').length());
+    //single character items are numbers or letter of acronyms, so don't put spaces between them
+    if ((umlautLength > 1) && (displayPinyin.length() > displayStart)) {
+        displayPinyin += " ";
+    }
+    int start = displayPinyin.length();
+    for (i=0; i < length; i++) {
+        QChar c = syllable[i];
+        if ((i + 1 < length) && (syllable[i+1] == QChar(':')) && ((c == QChar('u')) || (c == QChar('U')))) {
+            displayPinyin += (c == QChar('u')) ? QChar(L'ü') : QChar(L'Ü');
+            i++;
+            continue;
+        }
+        if (umlautLength > 1) {
+            //if single character, might actually be matching 'V' e.g. VCR
+            if (c == QChar('v')) c = QChar(L'ü');
+            if (c == QChar('V')) c = QChar(L'Ü');
+        }
+        displayPinyin += c;
+    }
+
+    if (tonelessSearchPinyin != NULL) {
+        _appendLower(displayPinyin.constData() + start, displayPinyin.length() - start, true, *tonelessSearchPinyin);
+    }
+    _insertToneMark(displayPinyin.data() + start, displayPinyin.length() - start, toneNum);
+    if (tonemarkedSearchPinyin != NULL) {
+        _appendLower(displayPinyin.constData() + start, displayPinyin.length() - start, false, *tonemarkedSearchPinyin);
+    }
+    if (toneNums != NULL) {
+        *toneNums += QChar('0' + toneNum);
+        if (hasNext) *toneNums += ",";
+    }
+    if (componentPinyin != NULL) {
+        _appendLower(displayPinyin.constData() + start, displayPinyin.length() - start, false, *componentPinyin);
+        if (hasNext) *componentPinyin += ",";
+    }
 }
 
+static void _appendCedictPinyin(const QChar* source, int length,
+                                QString& displayPinyin,
+                                QString* tonemarkedSearchPinyin,
+                                QString* tonelessSearchPinyin,
+                                QString* toneNums,
+                                QString* componentPinyin)
+{
+    int displayStart = displayPinyin.length();
+    //as with QString::split(" "), every space starts another item, even an empty one
+    int itemStart = 0;
+    while (itemStart <= length) {
+        int itemEnd = itemStart;
+        while ((itemEnd < length) && (source[itemEnd] != QChar(' '))) itemEnd++;
+        _appendCedictSyllable(source + itemStart, itemEnd - itemStart, itemEnd < length, displayStart,
+                              displayPinyin, tonemarkedSearchPinyin, tonelessSearchPinyin, toneNums, componentPinyin);
+        itemStart = itemEnd + 1;
+    }
+}
+
+void parseCedictEntry(const QChar* source, int length,
+                      QString& displayPinyin,
+                      QString& tonemarkedSearchPinyin,
+                      QString& tonelessSearchPinyin,
+                      QString& toneNums,
+                      QString& componentPinyin)
+{
+    qCDebug(lcImport) << "parseCedictEntry: " << QString::fromRawData(source, length);
+
+    //cleared keeping their capacity, so a reused buffer stops allocating
+    clearBuffer(displayPinyin);
+    clearBuffer(tonemarkedSearchPinyin);
+    clearBuffer(tonelessSearchPinyin);
+    clearBuffer(toneNums);
+    clearBuffer(componentPinyin);
+    _appendCedictPinyin(source, length, displayPinyin, &tonemarkedSearchPinyin, &tonelessSearchPinyin,
+                        &toneNums, &componentPinyin);
+
+    qCDebug(lcImport) << "displayPinyin:" << displayPinyin;
+    qCDebug(lcImport) << "tonemarkedSearchPinyin:" << tonemarkedSearchPinyin;
+    qCDebug(lcImport) << "tonelessSearchPinyin:" << tonelessSearchPinyin;
+    qCDebug(lcImport) << "toneNums:" << toneNums;
+    qCDebug(lcImport) << "componentPinyin:" << componentPinyin;
+    assert(toneNums.count(',') == componentPinyin.count(','));
+}
+
+void parseCedictEntry(const QString& source, //input
+                      QString& displayPinyin,           //out
+                      QString& tonemarkedSearchPinyin,  //out
+                      QString& tonelessSearchPinyin,    //out
+                      QString& toneNums,                //out
+                      QString& componentPinyin)         //out
+{
+    parseCedictEntry(source.constData(), source.length(), displayPinyin, tonemarkedSearchPinyin,
+                     tonelessSearchPinyin, toneNums, componentPinyin);
+}
+
+void appendDisplayPinyin(const QChar* source, int length, QString& out)
+{
+    _appendCedictPinyin(source, length, out, NULL, NULL, NULL, NULL);
+}
 
-//wrapper function, mainly for testing convenience
 QString makeDisplayPinyin(const QString source) {
-    QString displayPinyin, tonemarkedSearchPinyin, tonelessSearchPinyin, toneNums, componentPinyin;
-    parseCedictEntry(source, displayPinyin, tonemarkedSearchPinyin, tonelessSearchPinyin, toneNums, componentPinyin);
-    assert(makeToneMarkedSearchPinyin(source) == tonemarkedSearchPinyin);
-    assert(makeTonelessSearchPinyin(source) == tonelessSearchPinyin);
+    QString displayPinyin;
+    appendDisplayPinyin(source.constData(), source.length(), displayPinyin);
     return displayPinyin;
 }
@@ -20,6 +20,23 @@
 
 #include <QObject>
 #include <QList>
+#include <QStringList>
+
+//character classes, or'd together by classifyText()
+enum {
+    ccHan = 0x01,               //any Han character, including outside the BMP
+    ccLatinLetter = 0x02,       //a-z, A-Z
+    ccUmlautU = 0x04,           //ü, Ü
+    ccToneMarkedVowel = 0x08,   //ā, Ǘ etc.
+    ccToneDigit = 0x10,         //1-5
+    ccPunctuation = 0x20        //the punctuation inside headwords: , · 、
+};
+
+uint classifyChar(uint ucs4);
+//every class found in the text, in one pass
+uint classifyText(const QChar* text, int length);
+inline uint classifyText(const QString& text) { return classifyText(text.constData(), text.length()); }
+int charClassTableSize();
 
 bool isHanzi(const QString& text);
 bool isPunctuation(const QString& text);
@@ -34,16 +51,66 @@ void parseCedictEntry(const QString& source, //input
 QString makeDisplayPinyin(const QString source) ;
 QString makeTonelessSearchPinyin(const QString& words);
 QString makeToneMarkedSearchPinyin(const QString& words);
+
+//the same conversions reading part of a string and appending to a buffer
+//the caller keeps. with a buffer reused for every entry or keystroke the
+//conversion itself stops allocating once the buffer has grown
+void parseCedictEntry(const QChar* source, int length,  //input
+                      QString& displayPinyin,           //out, cleared first
+                      QString& tonemarkedSearchPinyin,  //out, cleared first
+                      QString& tonelessSearchPinyin,    //out, cleared first
+                      QString& toneNums,                //out, cleared first
+                      QString& componentPinyin);        //out, cleared first
+void appendDisplayPinyin(const QChar* source, int length, QString& out);
+//empties a buffer without giving up its capacity
+void clearBuffer(QString& buffer);
+//replaces the contents of out with text as utf-8, as toUtf8() would,
+//reusing its capacity. for binding to sqlite with SQLITE_STATIC
+void setUtf8(const QChar* text, int length, QByteArray& out);
+void appendTonelessSearchPinyin(const QChar* words, int length, QString& out);
+void appendToneMarkedSearchPinyin(const QChar* words, int length, QString& out);
+//folds syllable by syllable, so takes toneless pinyin with or without
+//tone digits, not the spaceless output of appendTonelessSearchPinyin()
+void appendFuzzySearchPinyin(const QChar* toneless, int length, QString& out);
+QString makeFuzzySearchPinyin(const QString& words);
+void appendInitialsSearchPinyin(const QChar* componentPinyin, int length, QString& out);
+QString makeInitialsSearchPinyin(const QString& componentPinyin);
+void appendSyllableSearchPinyin(const QChar* componentPinyin, int length, QString& out);
+QString makeSyllableSearchPinyin(const QString& componentPinyin);
+QStringList splitTonelessSyllables(const QString& words);
+//syllables as made by appendSyllableSearchPinyin()
+void appendHanziSyllableSearchText(const QChar* hanzi, int hanziLength,
+                                   const QChar* syllables, int syllablesLength, QString& out);
+QString makeHanziSyllableSearchText(const QString& hanzi, const QString& componentPinyin);
+QStringList splitMixedSearchText(const QString& text);
+QStringList tokenizeEnglish(const QString& text);
+QString stemEnglish(const QString& term);
+QString makeLookupKey(const QString& text);
 //QList<int> getToneNumbersFromMarkedString(const QString& toneMarked);
 
 
 typedef enum {
     tfHanzi,
     tfPinyinNoTones,
+    tfPinyinInitials,
     tfPinyinNumbers,
-    tfPinyinTonemarks
+    tfPinyinTonemarks,
+    tfMixed
 } textFormat_t;
 
 textFormat_t determineTextFormat(const QString& text);
 
+//the fts queries for one pinyin search, kept by the caller between keystrokes
+struct PinyinSearchQueries {
+    QString text;       //the search lowercased, without spaces
+    QString pinyin;     //for the column matching textFormat
+    QString syllables;  //toneless syllables as a phrase, empty unless there are several
+    QString fuzzy;      //toneless with the confusable sounds folded, if asked for
+};
+
+//makes every query for a pinyin search into the buffers in queries,
+//which stop allocating once they have grown
+void makePinyinSearchQueries(const QString& search, textFormat_t textFormat, bool withFuzzy,
+                             PinyinSearchQueries& queries);
+
 #endif // PINYINUTILS_H
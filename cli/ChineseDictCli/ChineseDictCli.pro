@@ -0,0 +1,34 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG += c++14
+# debug output, see logging.h, is compiled out of release builds
+CONFIG(release, debug|release): DEFINES += QT_NO_DEBUG_OUTPUT
+
+QT += core
+
+INCLUDEPATH += ../../app/ChineseDictApp
+INCLUDEPATH += ../../sqlite-amalgamation-3220000
+
+SOURCES += \
+    ../../sqlite-amalgamation-3220000/sqlite3.c \
+    ../../app/ChineseDictApp/textutils.cpp \
+    ../../app/ChineseDictApp/pinyinsyllables.cpp \
+    ../../app/ChineseDictApp/logging.cpp \
+    ../../app/ChineseDictApp/qobjectlistmodel.cpp \
+    ../../app/ChineseDictApp/dictdb.cpp \
+    ../../app/ChineseDictApp/englishsearch.cpp \
+    ../../app/ChineseDictApp/detailscache.cpp \
+    ../../app/ChineseDictApp/headwordindex.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../sqlite-amalgamation-3220000/sqlite3.h \
+    ../../app/ChineseDictApp/textutils.h \
+    ../../app/ChineseDictApp/pinyinsyllables.h \
+    ../../app/ChineseDictApp/logging.h \
+    ../../app/ChineseDictApp/qobjectlistmodel.h \
+    ../../app/ChineseDictApp/dictdb.h \
+    ../../app/ChineseDictApp/englishsearch.h \
+    ../../app/ChineseDictApp/detailscache.h \
+    ../../app/ChineseDictApp/headwordindex.h
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <string.h>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTextStream>
+#include "dictdb.h"
+
+#define DB_FILE "words.db"
+
+//runs DictDb queries without the UI and prints one json line per query.
+//usage: ChineseDictCli [--db words.db] [--time] [--cache-mb n] [command argument]
+//commands are "chinese <search>", "english <search>", "details <wordsKey>"
+//and "classifiers <search>". with no command they are read from stdin, one per line,
+//and repeated details come from the details cache. --time also reports its hits
+
+static QJsonArray resultsJson(QObjectList* results)
+{
+    QJsonArray array = QJsonArray::fromVariantList(DictDb::resultsPayload(results));
+    qDeleteAll(*results);
+    delete results;
+    return array;
+}
+
+//runs one command with DictDb's synchronous calls
+static bool runCommand(DictDb* dictDb, const QString& command, const QString& argument, bool timing)
+{
+    QJsonObject line;
+    QElapsedTimer timer;
+    timer.start();
+    if (command == "chinese") {
+        line.insert("results", resultsJson(dictDb->matchChinese(argument)));
+    } else if (command == "english") {
+        line.insert("results", resultsJson(dictDb->matchEnglish(argument)));
+    } else if (command == "classifiers") {
+        line.insert("results", resultsJson(dictDb->matchChinese("CL:" + argument)));
+    } else if (command == "details") {
+        DetailsPayload details;
+        if (dictDb->requestDetails(argument.toInt(), details)) {
+            line.insert("extraInfo", QJsonObject::fromVariantMap(details.extraInfo));
+            line.insert("classifiers", QJsonArray::fromVariantList(details.classifiers));
+            line.insert("components", QJsonArray::fromVariantList(details.components));
+        }
+    } else {
+        fprintf(stderr, "unknown command %s\n", command.toUtf8().constData());
+        return false;
+    }
+    qint64 elapsed = timer.nsecsElapsed();
+
+    line.insert("query", command);
+    line.insert("search", argument);
+    if (timing) line.insert("ms", elapsed / 1000000.0);
+
+    QByteArray output = QJsonDocument(line).toJson(QJsonDocument::Compact);
+    fprintf(stdout, "%s\n", output.constData());
+    fflush(stdout);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QString dbPath = DB_FILE;
+    bool timing = false;
+    int cacheMb = -1;
+    QStringList arguments = app.arguments();
+    arguments.removeFirst();
+    while (!arguments.isEmpty() && arguments.first().startsWith("--")) {
+        QString option = arguments.takeFirst();
+        if ((option == "--db") && !arguments.isEmpty()) {
+            dbPath = arguments.takeFirst();
+        } else if (option == "--time") {
+            timing = true;
+        } else if ((option == "--cache-mb") && !arguments.isEmpty()) {
+            cacheMb = qMax(0, arguments.takeFirst().toInt());
+        } else {
+            fprintf(stderr, "unknown option %s\n", option.toUtf8().constData());
+            return 1;
+        }
+    }
+
+    DictDb dictDb(dbPath);
+    if (cacheMb >= 0) dictDb.detailsCache()->setMaxBytes(cacheMb * 1024 * 1024);
+
+    if (!arguments.isEmpty()) {
+        QString command = arguments.takeFirst();
+        return runCommand(&dictDb, command, arguments.join(' '), timing) ? 0 : 1;
+    }
+
+    QFile in;
+    in.open(stdin, QIODevice::ReadOnly);
+    QTextStream stream(&in);
+    stream.setCodec("UTF-8");
+    QString line;
+    while (!(line = stream.readLine()).isNull()) {
+        line = line.trimmed();
+        if (line.isEmpty()) continue;
+        int space = line.indexOf(' ');
+        QString command = (space < 0) ? line : line.left(space);
+        QString argument = (space < 0) ? QString() : line.mid(space + 1).trimmed();
+        runCommand(&dictDb, command, argument, timing);
+    }
+
+    if (timing) {
+        DetailsCache* cache = dictDb.detailsCache();
+        fprintf(stderr, "details cache: %llu hits, %llu misses, %d entries, %d bytes\n",
+                (unsigned long long)cache->hits(), (unsigned long long)cache->misses(),
+                cache->count(), cache->bytes());
+    }
+    return 0;
+}
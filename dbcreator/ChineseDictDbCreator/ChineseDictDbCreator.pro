@@ -1,6 +1,9 @@
 TEMPLATE = app
 CONFIG += console
 CONFIG -= app_bundle
+CONFIG += c++14
+# debug output, see logging.h, is compiled out of release builds
+CONFIG(release, debug|release): DEFINES += QT_NO_DEBUG_OUTPUT
 
 INCLUDEPATH += ../../app/ChineseDictApp
 
@@ -8,9 +11,15 @@ SOURCES += \
     ../../sqlite-amalgamation-3220000/sqlite3.c \
     dbcreator.cpp \
     ../../app/ChineseDictApp/textutils.cpp \
+    ../../app/ChineseDictApp/pinyinsyllables.cpp \
+    ../../app/ChineseDictApp/logging.cpp \
+    ../../app/ChineseDictApp/headwordindex.cpp \
     main.cpp
 
 HEADERS += \
     ../../sqlite-amalgamation-3220000/sqlite3.h \
     dbcreator.h \
-    ../../app/ChineseDictApp/textutils.h
+    ../../app/ChineseDictApp/textutils.h \
+    ../../app/ChineseDictApp/pinyinsyllables.h \
+    ../../app/ChineseDictApp/logging.h \
+    ../../app/ChineseDictApp/headwordindex.h
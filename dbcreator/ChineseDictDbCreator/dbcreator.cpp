@@ -4,49 +4,106 @@
 #include <QRegExp>
 #include <QFile>
 #include <QHash>
+#include <QSet>
+#include <QVector>
+#include <algorithm>
 #include <assert.h>
 
 #include "dbcreator.h"
 #include "textutils.h"
+#include "logging.h"
+#include "headwordindex.h"
 #include "sqlite3.h"
 
 
 static sqlite3* s_db;
 static sqlite3_stmt* s_addWordStmt;
 static sqlite3_stmt* s_addClassifierUseStmt;
+static sqlite3_stmt* s_addEnglishPostingStmt;
+static sqlite3_stmt* s_addEnglishStemPostingStmt;
+
+//collected while adding postings, written out at the end
+static QHash<QString, int> s_englishTermDocCounts;
+static QHash<QString, int> s_englishStemDocCounts;
+static qint64 s_englishTotalDocLength = 0;
+static int s_englishDocCount = 0;
+
+struct EnglishPosting {
+    int termFreq;
+    int defIndex;   //first definition containing the term
+    bool exactGloss;
+};
+
+//how many of the best entries are kept for each english prefix
+#define ENGLISH_PREFIX_TOP_POSTINGS 100
+
+//an entry using a term, in the order entries are offered as completions
+struct EnglishPrefixEntry {
+    uint wordRank;
+    int defIndex;
+    int wordsKey;
+
+    bool operator<(const EnglishPrefixEntry& other) const {
+        if (wordRank != other.wordRank) return wordRank < other.wordRank;
+        if (defIndex != other.defIndex) return defIndex < other.defIndex;
+        return wordsKey < other.wordsKey;
+    }
+};
+
+//every entry using each term, for building english_prefixes
+static QHash<QString, QVector<EnglishPrefixEntry> > s_englishTermEntries;
+
+
+//the utf-8 of each column bound to s_addWordStmt, reused for every entry
+//and bound without sqlite making its own copy
+static QByteArray s_addWordUtf8[17];
 
+static void bindAddWordText(int column, const QString& text)
+{
+    QByteArray& utf8 = s_addWordUtf8[column];
+    setUtf8(text.constData(), text.length(), utf8);
+    sqlite3_bind_text(s_addWordStmt, column, utf8.constData(), utf8.length(), SQLITE_STATIC);
+}
 
 static bool addWord
-(QString traditional,
- QString simplified,
- QString displayPinyin,
- QString spacelessPinyin,
- QString tonelessPinyin,
- QString english,
- QString alsoWrittenAs,
- QString alsoPronounced,
- QString classifiers,
- QString toneNums,
- QString componentPinyin,
- uint wordRank)
+(const QString& traditional,
+ const QString& simplified,
+ const QString& displayPinyin,
+ const QString& spacelessPinyin,
+ const QString& tonelessPinyin,
+ const QString& english,
+ const QString& alsoWrittenAs,
+ const QString& alsoPronounced,
+ const QString& classifiers,
+ const QString& toneNums,
+ const QString& componentPinyin,
+ uint wordRank,
+ const QString& fuzzyPinyin,
+ const QString& initialsPinyin,
+ const QString& syllablePinyin,
+ const QString& hanziSyllables)
 {
     //add word to words table
-    sqlite3_bind_text(s_addWordStmt, 1, traditional.toUtf8(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(s_addWordStmt, 2, simplified.toUtf8(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(s_addWordStmt, 3, displayPinyin.toUtf8(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(s_addWordStmt, 4, spacelessPinyin.toUtf8(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(s_addWordStmt, 5, tonelessPinyin.toUtf8(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(s_addWordStmt, 6, english.toUtf8(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(s_addWordStmt, 7, alsoWrittenAs.toUtf8(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(s_addWordStmt, 8, alsoPronounced.toUtf8(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(s_addWordStmt, 9, classifiers.toUtf8(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(s_addWordStmt, 10, toneNums.toUtf8(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(s_addWordStmt, 11, componentPinyin.toUtf8(), -1, SQLITE_TRANSIENT);
+    bindAddWordText(1, traditional);
+    bindAddWordText(2, simplified);
+    bindAddWordText(3, displayPinyin);
+    bindAddWordText(4, spacelessPinyin);
+    bindAddWordText(5, tonelessPinyin);
+    bindAddWordText(6, english);
+    bindAddWordText(7, alsoWrittenAs);
+    bindAddWordText(8, alsoPronounced);
+    bindAddWordText(9, classifiers);
+    bindAddWordText(10, toneNums);
+    bindAddWordText(11, componentPinyin);
     sqlite3_bind_int(s_addWordStmt, 12, wordRank);
+    bindAddWordText(13, fuzzyPinyin);
+    bindAddWordText(14, initialsPinyin);
+    bindAddWordText(15, syllablePinyin);
+    bindAddWordText(16, hanziSyllables);
 
     int ret = sqlite3_step(s_addWordStmt);
     if (ret != SQLITE_DONE) {
-        qDebug() << "Error inserting :" << sqlite3_errmsg(s_db);
+        qCWarning(lcImport) << "Error inserting :" << sqlite3_errmsg(s_db);
         exit(1);
         return false;
     }
@@ -56,6 +113,259 @@ static bool addWord
     return true;
 }
 
+//if a definition is a single word once any leading "to", "a", "an" or "the" is ignored
+//(e.g. "to run", "a book") then that word is returned, otherwise an empty string
+static QString glossTerm(const QStringList& terms)
+{
+    int first = 0;
+    while ((first < terms.count() - 1) &&
+           ((terms[first] == "to") || (terms[first] == "a") ||
+            (terms[first] == "an") || (terms[first] == "the"))) {
+        first++;
+    }
+    if (first == terms.count() - 1) return terms[first];
+    return QString();
+}
+
+//adds a term occurrence to the postings for one entry
+static void addEnglishOccurrence(QHash<QString, EnglishPosting>& postings,
+                                 const QString& term, int defIndex, bool exactGloss)
+{
+    QHash<QString, EnglishPosting>::iterator it = postings.find(term);
+    if (it == postings.end()) {
+        EnglishPosting posting = { 0, defIndex, false };
+        it = postings.insert(term, posting);
+    }
+    it.value().termFreq++;
+    if (exactGloss) it.value().exactGloss = true;
+}
+
+static bool insertEnglishPostings(sqlite3_stmt* stmt,
+                                  QHash<QString, int>& docCounts,
+                                  sqlite3_int64 wordsKey,
+                                  const QHash<QString, EnglishPosting>& postings,
+                                  int docLength,
+                                  uint wordRank)
+{
+    QHashIterator<QString, EnglishPosting> iterator(postings);
+    while (iterator.hasNext()) {
+        iterator.next();
+        const EnglishPosting& posting = iterator.value();
+        sqlite3_bind_text(stmt, 1, iterator.key().toUtf8(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, wordsKey);
+        sqlite3_bind_int(stmt, 3, posting.termFreq);
+        sqlite3_bind_int(stmt, 4, posting.defIndex);
+        sqlite3_bind_int(stmt, 5, posting.exactGloss);
+        sqlite3_bind_int(stmt, 6, docLength);
+        sqlite3_bind_int(stmt, 7, wordRank);
+
+        int ret = sqlite3_step(stmt);
+        if (ret != SQLITE_DONE) {
+            qCWarning(lcImport) << "Error inserting english posting :" << sqlite3_errmsg(s_db);
+            exit(1);
+            return false;
+        }
+        sqlite3_reset(stmt);
+        docCounts[iterator.key()]++;
+    }
+    return true;
+}
+
+//indexes the english of one entry for searching.
+//each distinct term gets a single posting holding everything needed to score it,
+//so that searching never has to look at the english text itself.
+//every term is indexed twice: as written, and by its stem, so that
+//"running" finds "to run" while an exact "run" still scores higher
+static bool addEnglishPostings(sqlite3_int64 wordsKey, const QString& english, uint wordRank)
+{
+    QStringList definitions = english.split("/", QString::SkipEmptyParts);
+    QHash<QString, EnglishPosting> termPostings;
+    QHash<QString, EnglishPosting> stemPostings;
+    int docLength = 0;
+    int defIndex;
+    for (defIndex=0; defIndex < definitions.count(); defIndex++) {
+        QStringList terms = tokenizeEnglish(definitions[defIndex]);
+        QString gloss = glossTerm(terms);
+        docLength += terms.count();
+        int i;
+        for (i=0; i < terms.count(); i++) {
+            const QString& term = terms[i];
+            addEnglishOccurrence(termPostings, term, defIndex, term == gloss);
+            addEnglishOccurrence(stemPostings, stemEnglish(term), defIndex, term == gloss);
+        }
+    }
+    if (termPostings.isEmpty()) return true;
+
+    s_englishDocCount++;
+    s_englishTotalDocLength += docLength;
+
+    QHashIterator<QString, EnglishPosting> iterator(termPostings);
+    while (iterator.hasNext()) {
+        iterator.next();
+        EnglishPrefixEntry entry = { wordRank, iterator.value().defIndex, (int)wordsKey };
+        s_englishTermEntries[iterator.key()].append(entry);
+    }
+
+    return insertEnglishPostings(s_addEnglishPostingStmt, s_englishTermDocCounts,
+                                 wordsKey, termPostings, docLength, wordRank) &&
+           insertEnglishPostings(s_addEnglishStemPostingStmt, s_englishStemDocCounts,
+                                 wordsKey, stemPostings, docLength, wordRank);
+}
+
+static bool insertEnglishDocCounts(const char* table, const QHash<QString, int>& docCounts)
+{
+    sqlite3_stmt* stmt;
+    QByteArray query = QByteArray("INSERT INTO ") + table + " VALUES (?, ?)";
+    sqlite3_prepare_v2(s_db, query.constData(), query.size(), &stmt, NULL);
+    QHashIterator<QString, int> iterator(docCounts);
+    while (iterator.hasNext()) {
+        iterator.next();
+        sqlite3_bind_text(stmt, 1, iterator.key().toUtf8(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 2, iterator.value());
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            qCWarning(lcImport) << "Error inserting into" << table << ":" << sqlite3_errmsg(s_db);
+            sqlite3_finalize(stmt);
+            return false;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+//for every prefix of every english term, stores the best entries using
+//any term with that prefix, so a partly typed word is a single lookup.
+//entries are ordered by word_rank, then by how early the term appears.
+//an entry is in a term's list once, so only a term's own best entries can
+//be among the best for a prefix, and the rest are dropped before copying
+static bool addEnglishPrefixes()
+{
+    QHash<QString, QVector<EnglishPrefixEntry> > prefixEntries;
+    QMutableHashIterator<QString, QVector<EnglishPrefixEntry> > termIterator(s_englishTermEntries);
+    while (termIterator.hasNext()) {
+        termIterator.next();
+        const QString& term = termIterator.key();
+        QVector<EnglishPrefixEntry>& termEntries = termIterator.value();
+        int count = qMin(termEntries.count(), ENGLISH_PREFIX_TOP_POSTINGS);
+        std::partial_sort(termEntries.begin(), termEntries.begin() + count, termEntries.end());
+        termEntries.resize(count);
+        int length;
+        for (length=1; length <= term.length(); length++) {
+            prefixEntries[term.left(length)] += termEntries;
+        }
+    }
+
+    sqlite3_stmt* stmt;
+    QByteArray query = "INSERT INTO english_prefixes VALUES (?, ?)";
+    sqlite3_prepare_v2(s_db, query.constData(), query.size(), &stmt, NULL);
+    QMutableHashIterator<QString, QVector<EnglishPrefixEntry> > iterator(prefixEntries);
+    while (iterator.hasNext()) {
+        iterator.next();
+        QVector<EnglishPrefixEntry>& entries = iterator.value();
+        std::sort(entries.begin(), entries.end());
+
+        //an entry may use several terms with the prefix, keep its best
+        QSet<int> seen;
+        QStringList wordsKeys;
+        int i;
+        for (i=0; (i < entries.count()) && (wordsKeys.count() < ENGLISH_PREFIX_TOP_POSTINGS); i++) {
+            if (seen.contains(entries[i].wordsKey)) continue;
+            seen.insert(entries[i].wordsKey);
+            wordsKeys.append(QString::number(entries[i].wordsKey));
+        }
+
+        sqlite3_bind_text(stmt, 1, iterator.key().toUtf8(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, wordsKeys.join(",").toUtf8(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            qCWarning(lcImport) << "Error inserting english prefix :" << sqlite3_errmsg(s_db);
+            sqlite3_finalize(stmt);
+            return false;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    qCDebug(lcImport) << "english prefixes: " << prefixEntries.count();
+    return true;
+}
+
+//writes the per-term document counts and the collection statistics
+//gathered by addEnglishPostings()
+static bool addEnglishStats()
+{
+    if (!insertEnglishDocCounts("english_terms", s_englishTermDocCounts)) return false;
+    if (!insertEnglishDocCounts("english_stem_terms", s_englishStemDocCounts)) return false;
+
+    sqlite3_stmt* stmt;
+    double averageDocLength = s_englishDocCount ? (double)s_englishTotalDocLength / s_englishDocCount : 0;
+    QByteArray query = "INSERT INTO english_stats VALUES (?, ?)";
+    sqlite3_prepare_v2(s_db, query.constData(), query.size(), &stmt, NULL);
+    sqlite3_bind_int(stmt, 1, s_englishDocCount);
+    sqlite3_bind_double(stmt, 2, averageDocLength);
+    int ret = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (ret != SQLITE_DONE) {
+        qCWarning(lcImport) << "Error inserting english stats :" << sqlite3_errmsg(s_db);
+        return false;
+    }
+
+    qCDebug(lcImport) << "english terms: " << s_englishTermDocCounts.count()
+             << " stems: " << s_englishStemDocCounts.count()
+             << " docs: " << s_englishDocCount
+             << " average length: " << averageDocLength;
+    return true;
+}
+
+//builds the suffix array the app uses to find hanzi anywhere in a headword,
+//with the entries most common first so results come out ranked
+static bool addHeadwordIndex()
+{
+    HeadwordIndex index;
+    sqlite3_stmt* stmt;
+    QByteArray query = "SELECT rowid, traditional, simplified FROM words ORDER BY word_rank ASC";
+    sqlite3_prepare_v2(s_db, query.constData(), query.size(), &stmt, NULL);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        index.addEntry(sqlite3_column_int(stmt, 0),
+                       QString::fromUtf8((const char*)sqlite3_column_text(stmt, 1)),
+                       QString::fromUtf8((const char*)sqlite3_column_text(stmt, 2)));
+    }
+    sqlite3_finalize(stmt);
+    index.build();
+
+    QByteArray data = index.serialize();
+    query = "INSERT INTO headword_index VALUES (?)";
+    sqlite3_prepare_v2(s_db, query.constData(), query.size(), &stmt, NULL);
+    sqlite3_bind_blob(stmt, 1, data.constData(), data.size(), SQLITE_TRANSIENT);
+    int ret = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (ret != SQLITE_DONE) {
+        qCWarning(lcImport) << "Error inserting headword index :" << sqlite3_errmsg(s_db);
+        return false;
+    }
+
+    qCDebug(lcImport) << "headword index: " << index.entryCount() << " entries, "
+             << data.size() << " bytes";
+    return true;
+}
+
+//a sorted, exact key index over headwords and pinyin for BatchLookup,
+//the keys are what makeLookupKey() makes from a search
+static bool addHeadwordKeys()
+{
+    char* errmsg;
+    int ret = sqlite3_exec(s_db,
+        "INSERT OR IGNORE INTO headword_keys SELECT traditional, rowid FROM words;"
+        "INSERT OR IGNORE INTO headword_keys SELECT simplified, rowid FROM words;"
+        "INSERT OR IGNORE INTO headword_keys SELECT pinyin_spaceless, rowid FROM words;"
+        "INSERT OR IGNORE INTO headword_keys SELECT pinyin_toneless, rowid FROM words;",
+        NULL, 0, &errmsg);
+    if (ret != SQLITE_OK) {
+        qCWarning(lcImport) << "Error filling headword_keys: " << errmsg;
+        return false;
+    }
+    return true;
+}
+
 static bool parseFreqListFile(QHash<QString, int>& rankDict, const QString& path)
 {
     QFile file(path);
@@ -76,7 +386,7 @@ static bool parseFreqListFile(QHash<QString, int>& rankDict, const QString& path
         //qDebug() << "line <" << line << ">  list:" << list;
 
         if (list.size() != 4) {
-            qDebug() << "error, found " << list.size();
+            qCDebug(lcImport) << "error, found " << list.size();
             continue;
         }
         if (list[1].isEmpty()) continue;
@@ -90,6 +400,59 @@ static bool parseFreqListFile(QHash<QString, int>& rankDict, const QString& path
 }
 
 
+//sets each buffer to a field of a cedict line, as the captures of
+//^([^\s]+)\s+([^\s]+)\s+\[(.+)\]\s+\/(.+)\/\s*$ would be,
+//but without making a new string for every one.
+//returns false if the line doesn't match
+static bool splitCedictLine(const QString& line, QString& traditional, QString& simplified,
+                            QString& pinyin, QString& english)
+{
+    const QChar* text = line.constData();
+    int length = line.length();
+    while ((length > 0) && text[length - 1].isSpace()) length--;
+    if ((length == 0) || (text[length - 1] != QChar('/'))) return false;
+    int englishEnd = length - 1;
+
+    int traditionalEnd = 0;
+    while ((traditionalEnd < length) && !text[traditionalEnd].isSpace()) traditionalEnd++;
+    int simplifiedStart = traditionalEnd;
+    while ((simplifiedStart < length) && text[simplifiedStart].isSpace()) simplifiedStart++;
+    int simplifiedEnd = simplifiedStart;
+    while ((simplifiedEnd < length) && !text[simplifiedEnd].isSpace()) simplifiedEnd++;
+    int pinyinStart = simplifiedEnd;
+    while ((pinyinStart < length) && text[pinyinStart].isSpace()) pinyinStart++;
+    if ((traditionalEnd == 0) || (simplifiedStart == traditionalEnd) ||
+        (simplifiedEnd == simplifiedStart) || (pinyinStart == simplifiedEnd) ||
+        (pinyinStart == length) || (text[pinyinStart] != QChar('['))) {
+        return false;
+    }
+    pinyinStart++;
+
+    //greedy, so the pinyin runs to the last "] /" that still leaves some english
+    int pinyinEnd;
+    int englishStart = 0;
+    for (pinyinEnd = englishEnd - 1; pinyinEnd > pinyinStart; pinyinEnd--) {
+        if (text[pinyinEnd] != QChar(']')) continue;
+        int slash = pinyinEnd + 1;
+        while ((slash < englishEnd) && text[slash].isSpace()) slash++;
+        if ((slash > pinyinEnd + 1) && (slash < englishEnd - 1) && (text[slash] == QChar('/'))) {
+            englishStart = slash + 1;
+            break;
+        }
+    }
+    if (pinyinEnd == pinyinStart) return false;
+
+    clearBuffer(traditional);
+    traditional.append(text, traditionalEnd);
+    clearBuffer(simplified);
+    simplified.append(text + simplifiedStart, simplifiedEnd - simplifiedStart);
+    clearBuffer(pinyin);
+    pinyin.append(text + pinyinStart, pinyinEnd - pinyinStart);
+    clearBuffer(english);
+    english.append(text + englishStart, englishEnd - englishStart);
+    return true;
+}
+
 static bool parseCedictFile(const QHash<QString, int>& rankDict, const QString& path)
 {
 
@@ -104,48 +467,63 @@ static bool parseCedictFile(const QHash<QString, int>& rankDict, const QString&
     uint rankedWords = 0;
     uint unrankedWords = 0;
 
-    QRegExp cedictRegEx("^([^\\s]+)\\s+([^\\s]+)\\s+\\[(.+)\\]\\s+\\/(.+)\\/\\s*$");
     QTextStream stream(&file);
     QString line;
-    do {
-        line = stream.readLine();
-        cedictRegEx.indexIn(line);
-        QStringList list = cedictRegEx.capturedTexts();
-        //qDebug() << "line <" << line << ">  list:" << list;
-        if (list.size() != 5) {
-            qDebug() << "error, found " << list.size();
+
+    //kept across entries, so that splitting the line, making the pinyin
+    //search forms and binding them stop allocating once they have grown.
+    //the english below is still split and matched with fresh strings
+    QString traditional;
+    QString simplified;
+    QString numberedPinyin;
+    QString rawEnglish;
+    QString displayPinyin; //e.g. "Ài ěr lán", "shí tou, jiǎn zi bù"
+    QString tonemarkedSearchPinyin; //used for search. e.g. "àiěrlán", "shítoujiǎnzibù"
+    QString tonelessSearchPinyin; //used for search.  e.g. "aierlan", "shitoujianzibu"
+    QString toneNums; //comma separated tone numbers (1-5)
+    QString componentPinyin; //comma separated tonemarked pinyin components e.g. shí,tou,jiǎn,zi,bù
+    QString initialsPinyin; //used for search by initials. e.g. "stjzb"
+    QString syllablePinyin; //used for per-syllable search. e.g. "shi tou jian zi bu"
+    QString fuzzyPinyin; //used for fuzzy search, folded per syllable. e.g. "sitoujianzibu"
+    QString hanziSyllables; //used for mixed hanzi/pinyin search. e.g. "shi石 tou头 jian剪 zi子 bu布"
+    QString converted;
+    //so that a blank line doesn't free it
+    line.reserve(256);
+    while (stream.readLineInto(&line)) {
+        if (!splitCedictLine(line, traditional, simplified, numberedPinyin, rawEnglish)) {
+            qCDebug(lcImport) << "error, no match for " << line;
             continue;
         }
-
-        if (list[1].isEmpty()) continue;
 /*
-        qDebug() << "traditional: " << list[1];
-        qDebug() << "simplified: " << list[2];
-        qDebug() << "pinyin: " << list[3];
-        qDebug() << "english: " << list[4];
+        qCDebug(lcImport) << "traditional: " << traditional;
+        qCDebug(lcImport) << "simplified: " << simplified;
+        qCDebug(lcImport) << "pinyin: " << numberedPinyin;
+        qCDebug(lcImport) << "english: " << rawEnglish;
 */
 
-        QString numberedPinyin = list[3];
-
-        qDebug() << "\nnumbered pinyin: " << numberedPinyin;
+        qCDebug(lcImport) << "\nnumbered pinyin: " << numberedPinyin;
 
         //QString toneNums = extractToneNumbers(numberedPinyin);
 
-        QString displayPinyin; //e.g. "Ài ěr lán", "shí tou, jiǎn zi bù"
-        QString tonemarkedSearchPinyin; //used for search. e.g. "àiěrlán", "shítoujiǎnzibù"
-        QString tonelessSearchPinyin; //used for search.  e.g. "aierlan", "shitoujianzibu"
-        QString toneNums; //comma separated tone numbers (1-5)
-        QString componentPinyin; //comma separated tonemarked pinyin components e.g. shí,tou,jiǎn,zi,bù
-        parseCedictEntry(numberedPinyin,
+        parseCedictEntry(numberedPinyin.constData(), numberedPinyin.length(),
                          displayPinyin,
                          tonemarkedSearchPinyin,
                          tonelessSearchPinyin,
                          toneNums,
                          componentPinyin);
+        clearBuffer(initialsPinyin);
+        appendInitialsSearchPinyin(componentPinyin.constData(), componentPinyin.length(), initialsPinyin);
+        clearBuffer(syllablePinyin);
+        appendSyllableSearchPinyin(componentPinyin.constData(), componentPinyin.length(), syllablePinyin);
+        clearBuffer(fuzzyPinyin);
+        appendFuzzySearchPinyin(syllablePinyin.constData(), syllablePinyin.length(), fuzzyPinyin);
+        clearBuffer(hanziSyllables);
+        appendHanziSyllableSearchText(simplified.constData(), simplified.length(),
+                                      syllablePinyin.constData(), syllablePinyin.length(), hanziSyllables);
 /*
-        qDebug() << "displayPinyin: " << displayPinyin;
-        qDebug() << "tonemarkedSearchPinyin: " << tonemarkedSearchPinyin;
-        qDebug() << "tonelessSearchPinyin: " << tonelessSearchPinyin;
+        qCDebug(lcImport) << "displayPinyin: " << displayPinyin;
+        qCDebug(lcImport) << "tonemarkedSearchPinyin: " << tonemarkedSearchPinyin;
+        qCDebug(lcImport) << "tonelessSearchPinyin: " << tonelessSearchPinyin;
 */
         //need to convert inline pinyin in english defs
         //wrapped in [ ], may be more than one instance
@@ -158,15 +536,16 @@ static bool parseCedictFile(const QHash<QString, int>& rankDict, const QString&
         QRegExp inlinePinyinMatch("\\[((?:[\\w+\\:] *)+)\\]");
         int pos = 0;
         int endOfLastMatch = 0;
-        QString rawEnglish = list[4];
 
         //qDebug() << "rawEnglish: " << rawEnglish;
         QString pinyinisedEnglish;
         while ((pos = inlinePinyinMatch.indexIn(rawEnglish, pos)) != -1) {
             //copy english up until the point of the match
             pinyinisedEnglish += rawEnglish.mid(endOfLastMatch, pos-endOfLastMatch);
-            QString converted = makeDisplayPinyin(inlinePinyinMatch.cap(1));
-            qDebug() << " converted " << inlinePinyinMatch.cap(1) << " to " << converted;
+            QString inlinePinyin = inlinePinyinMatch.cap(1);
+            clearBuffer(converted);
+            appendDisplayPinyin(inlinePinyin.constData(), inlinePinyin.length(), converted);
+            qCDebug(lcImport) << " converted " << inlinePinyinMatch.cap(1) << " to " << converted;
             pinyinisedEnglish += " " + converted;
             pos += inlinePinyinMatch.matchedLength();
             endOfLastMatch = pos;
@@ -244,15 +623,15 @@ static bool parseCedictFile(const QHash<QString, int>& rankDict, const QString&
 
 
         uint rank = 999999;
-        if (rankDict.contains(list[2])) {
-            rank = rankDict.value(list[2]);
+        if (rankDict.contains(simplified)) {
+            rank = rankDict.value(simplified);
             //qDebug() << " ranked as " << rank;
             rankedWords++;
         } else {
-            //qDebug() << " no rank entry for " << list[2];
+            //qDebug() << " no rank entry for " << simplified;
             unrankedWords++;
         }
-        bool ok = addWord(list[1], list[2],
+        bool ok = addWord(traditional, simplified,
                 displayPinyin, tonemarkedSearchPinyin, tonelessSearchPinyin,
                 english,
                 alsoWritten,
@@ -260,12 +639,18 @@ static bool parseCedictFile(const QHash<QString, int>& rankDict, const QString&
                 classifiers,
                 toneNums,
                 componentPinyin,
-                rank);
+                rank,
+                fuzzyPinyin,
+                initialsPinyin,
+                syllablePinyin,
+                hanziSyllables);
+        assert(ok);
+        ok = addEnglishPostings(sqlite3_last_insert_rowid(s_db), english, rank);
         assert(ok);
         //qDebug();
-    } while (!line.isNull());
+    }
 
-    qDebug() << "rankedWords: " << rankedWords << " unrankedWords: " << unrankedWords;
+    qCDebug(lcImport) << "rankedWords: " << rankedWords << " unrankedWords: " << unrankedWords;
     return true;
 }
 
@@ -274,14 +659,15 @@ bool createDb(const char* dbPath, const char* cedictPath, const char* rankFilePa
 {
     int ret = sqlite3_open_v2(dbPath, &s_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
     if ((ret != SQLITE_OK) || (s_db == NULL)) {
-        qDebug() << "Error opening database";
+        qCWarning(lcImport) << "Error opening database";
         return false;
      }
 
 
+    //FTS4 rather than FTS3 so that queries can use "^" to anchor to the first token
     char *errmsg;
     ret = sqlite3_exec(s_db,
-        "CREATE VIRTUAL TABLE words using FTS3 ( "
+        "CREATE VIRTUAL TABLE words using FTS4 ( "
                "traditional text,"
                "simplified text,"
                "pinyin text,"
@@ -293,18 +679,80 @@ bool createDb(const char* dbPath, const char* cedictPath, const char* rankFilePa
                "classifiers text,"
                "tone_nums text,"
                "component_pinyin text,"
-               "word_rank integer);",
+               "word_rank integer,"
+               "pinyin_fuzzy text,"
+               "pinyin_initials text,"
+               "pinyin_syllables text,"
+               "hanzi_syllables text);",
+         NULL, 0, &errmsg);
+
+    if(ret != SQLITE_OK) {
+        qCWarning(lcImport) << "Error creating words table: " << errmsg;
+      return false;
+    }
+
+    qCDebug(lcImport) << "created ok";
+
+
+    //english search index: one posting per (term, word) with its scoring features,
+    //the same again keyed by stem, plus document counts and collection statistics for BM25.
+    //english_terms is also the sorted term dictionary for prefix completion,
+    //and english_prefixes holds the best entries for each prefix
+    ret = sqlite3_exec(s_db,
+        "CREATE TABLE english_postings ( "
+               "term text,"
+               "words_key integer,"
+               "term_freq integer,"
+               "def_index integer,"
+               "exact_gloss integer,"
+               "doc_length integer,"
+               "word_rank integer,"
+               "PRIMARY KEY (term, words_key)) WITHOUT ROWID;"
+        "CREATE TABLE english_terms ( "
+               "term text PRIMARY KEY,"
+               "doc_count integer) WITHOUT ROWID;"
+        "CREATE TABLE english_stem_postings ( "
+               "stem text,"
+               "words_key integer,"
+               "term_freq integer,"
+               "def_index integer,"
+               "exact_gloss integer,"
+               "doc_length integer,"
+               "word_rank integer,"
+               "PRIMARY KEY (stem, words_key)) WITHOUT ROWID;"
+        "CREATE TABLE english_stem_terms ( "
+               "stem text PRIMARY KEY,"
+               "doc_count integer) WITHOUT ROWID;"
+        "CREATE TABLE english_prefixes ( "
+               "prefix text PRIMARY KEY,"
+               "words_keys text) WITHOUT ROWID;"
+        "CREATE TABLE english_stats ( "
+               "doc_count integer,"
+               "average_doc_length real);",
          NULL, 0, &errmsg);
 
     if(ret != SQLITE_OK) {
-        qDebug() << "Error creating words table: " << errmsg;
+        qCWarning(lcImport) << "Error creating english tables: " << errmsg;
       return false;
     }
 
-    qDebug() << "created ok";
+    //a single row holding the serialized HeadwordIndex,
+    //and the key index for looking up many words at once
+    ret = sqlite3_exec(s_db,
+        "CREATE TABLE headword_index ( "
+               "data blob);"
+        "CREATE TABLE headword_keys ( "
+               "key text,"
+               "words_key integer,"
+               "PRIMARY KEY (key, words_key)) WITHOUT ROWID;",
+         NULL, 0, &errmsg);
 
+    if(ret != SQLITE_OK) {
+        qCWarning(lcImport) << "Error creating headword tables: " << errmsg;
+      return false;
+    }
 
-    QString query = QString("INSERT INTO words VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    QString query = QString("INSERT INTO words VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
 
     QByteArray queryUtf8 = query.toUtf8();
 
@@ -314,12 +762,37 @@ bool createDb(const char* dbPath, const char* cedictPath, const char* rankFilePa
         &s_addWordStmt,
         NULL);
 
+    query = QString("INSERT INTO english_postings VALUES (?, ?, ?, ?, ?, ?, ?)");
+    queryUtf8 = query.toUtf8();
+    ret = sqlite3_prepare_v2(s_db,
+        queryUtf8.constData(),
+        queryUtf8.size(),
+        &s_addEnglishPostingStmt,
+        NULL);
+
+    query = QString("INSERT INTO english_stem_postings VALUES (?, ?, ?, ?, ?, ?, ?)");
+    queryUtf8 = query.toUtf8();
+    ret = sqlite3_prepare_v2(s_db,
+        queryUtf8.constData(),
+        queryUtf8.size(),
+        &s_addEnglishStemPostingStmt,
+        NULL);
+
     QHash<QString, int> rankDict;
     parseFreqListFile(rankDict, rankFilePath);
 
+    //one transaction for the whole import, rather than one per insert
+    sqlite3_exec(s_db, "BEGIN TRANSACTION;", NULL, 0, &errmsg);
     parseCedictFile(rankDict, cedictPath);
+    addEnglishStats();
+    addEnglishPrefixes();
+    addHeadwordIndex();
+    addHeadwordKeys();
+    sqlite3_exec(s_db, "COMMIT;", NULL, 0, &errmsg);
 
     sqlite3_finalize(s_addWordStmt);
+    sqlite3_finalize(s_addEnglishPostingStmt);
+    sqlite3_finalize(s_addEnglishStemPostingStmt);
     sqlite3_finalize(s_addClassifierUseStmt);
     sqlite3_close(s_db);
     s_db = NULL;
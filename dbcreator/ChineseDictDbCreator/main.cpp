@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <QElapsedTimer>
 #include "dbcreator.h"
 
 #define DB_CREATION_FILE "words.db"
@@ -8,7 +9,12 @@
 
 int main()
 {
+    //compare a debug build, the same with QT_LOGGING_RULES="chinesedict.import.debug=false",
+    //and a release build to see what the per entry logging costs
+    QElapsedTimer timer;
+    timer.start();
     createDb(DB_CREATION_FILE, CEDICT_FILE, WORD_RANK_FILE);
+    fprintf(stderr, "import took %lld ms\n", (long long)timer.elapsed());
 
     return 0;
 }
@@ -0,0 +1,32 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG += c++14
+# debug output, see logging.h, is compiled out of release builds
+CONFIG(release, debug|release): DEFINES += QT_NO_DEBUG_OUTPUT
+
+QT += core concurrent
+
+INCLUDEPATH += ../../app/ChineseDictApp
+INCLUDEPATH += ../../sqlite-amalgamation-3220000
+
+SOURCES += \
+    ../../sqlite-amalgamation-3220000/sqlite3.c \
+    ../../app/ChineseDictApp/textutils.cpp \
+    ../../app/ChineseDictApp/pinyinsyllables.cpp \
+    ../../app/ChineseDictApp/logging.cpp \
+    ../../app/ChineseDictApp/batchlookup.cpp \
+    ../../app/ChineseDictApp/segmenter.cpp \
+    ../../app/ChineseDictApp/textannotator.cpp \
+    ../../app/ChineseDictApp/pinyinconverter.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../sqlite-amalgamation-3220000/sqlite3.h \
+    ../../app/ChineseDictApp/textutils.h \
+    ../../app/ChineseDictApp/pinyinsyllables.h \
+    ../../app/ChineseDictApp/logging.h \
+    ../../app/ChineseDictApp/batchlookup.h \
+    ../../app/ChineseDictApp/segmenter.h \
+    ../../app/ChineseDictApp/textannotator.h \
+    ../../app/ChineseDictApp/pinyinconverter.h
@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <string.h>
+#include <QFile>
+#include "pinyinconverter.h"
+
+#define DB_FILE "words.db"
+
+//converts chinese text from a file (or stdin) to json lines of pinyin on stdout,
+//then reports the throughput on stderr
+//usage: ChineseDictPinyinConverter [--db words.db] [input.txt]
+int main(int argc, char *argv[])
+{
+    const char* dbPath = DB_FILE;
+    const char* inputPath = NULL;
+    int i;
+    for (i=1; i < argc; i++) {
+        if ((strcmp(argv[i], "--db") == 0) && (i + 1 < argc)) {
+            dbPath = argv[++i];
+        } else {
+            inputPath = argv[i];
+        }
+    }
+
+    PinyinConverter converter(QString::fromLocal8Bit(dbPath));
+    if (!converter.isOpen()) {
+        fprintf(stderr, "could not open %s\n", dbPath);
+        return 1;
+    }
+
+    QFile in;
+    bool opened;
+    if (inputPath) {
+        in.setFileName(QString::fromLocal8Bit(inputPath));
+        opened = in.open(QIODevice::ReadOnly);
+    } else {
+        opened = in.open(stdin, QIODevice::ReadOnly);
+    }
+    QFile out;
+    if (!opened || !out.open(stdout, QIODevice::WriteOnly)) {
+        fprintf(stderr, "could not open input\n");
+        return 1;
+    }
+
+    bool ok = converter.convert(&in, &out);
+    out.flush();
+
+    double seconds = converter.elapsedMs() / 1000.0;
+    fprintf(stderr, "%lld bytes, %lld words in %.2fs (%.2f MB/s)\n",
+            (long long)converter.bytesConverted(),
+            (long long)converter.wordsConverted(),
+            seconds,
+            (seconds > 0) ? converter.bytesConverted() / seconds / (1024 * 1024) : 0.0);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,9 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG += c++14
+
+QT += core network
+
+SOURCES += \
+    main.cpp
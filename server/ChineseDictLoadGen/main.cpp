@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QVector>
+
+#define DEFAULT_PORT 8765
+#define DEFAULT_CLIENTS 8
+#define DEFAULT_SECONDS 10
+
+//sends requests to a running ChineseDictServer from several keep-alive
+//connections at once, then reports requests per second and latency percentiles.
+//usage: ChineseDictLoadGen [--port 8765] [--clients 8] [--seconds 10] [--paths paths.txt]
+//paths.txt has one request path per line, e.g. "/search?q=zhongguo",
+//and they are sent round robin
+
+static const char* s_defaultPaths[] = {
+    "/search?q=%E4%B8%AD",                  //中
+    "/search?q=%E4%B8%AD%E5%9B%BD",         //中国
+    "/search?q=zhongguo",
+    "/search?q=zhong1guo2",
+    "/search?q=zh%20guo",
+    "/search?q=zg",
+    "/search?q=%E4%B8%ADguo",               //中guo
+    "/search?q=*%E5%AD%A6",                 //*学
+    "/search?q=CL:%E5%80%8B",               //CL:個
+    "/search?q=dog&mode=english",
+    "/search?q=to%20be%20able&mode=english",
+    "/search?q=comp&mode=english",
+    "/details?wordsKey=100",
+    "/details?wordsKey=5000",
+    "/details?wordsKey=20000",
+    "/classifiers?wordsKey=100",
+    "/components?wordsKey=5000",
+    NULL
+};
+
+struct LoadStats {
+    QVector<qint64> latencies;  //nanoseconds
+    int errors;
+    bool running;
+};
+
+//one connection, sending the next request as soon as the last is answered
+class LoadClient
+{
+private:
+    QTcpSocket m_socket;
+    const QList<QByteArray>& m_paths;
+    LoadStats& m_stats;
+    int m_next;
+    QByteArray m_buffer;
+    QElapsedTimer m_timer;
+
+    void sendNext()
+    {
+        if (!m_stats.running) return;
+        QByteArray request = "GET " + m_paths[m_next] + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        m_next = (m_next + 1) % m_paths.count();
+        m_timer.start();
+        m_socket.write(request);
+    }
+
+    void onReadyRead()
+    {
+        m_buffer.append(m_socket.readAll());
+        int headerEnd = m_buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) return;
+
+        QByteArray header = m_buffer.left(headerEnd).toLower();
+        int contentLength = 0;
+        int position = header.indexOf("content-length:");
+        if (position >= 0) {
+            int lineEnd = header.indexOf('\r', position);
+            contentLength = header.mid(position + 15, lineEnd - position - 15).trimmed().toInt();
+        }
+        if (m_buffer.length() < headerEnd + 4 + contentLength) return;
+
+        if (m_stats.running) {
+            m_stats.latencies.append(m_timer.nsecsElapsed());
+            if (!header.startsWith("http/1.1 200")) m_stats.errors++;
+        }
+        m_buffer.remove(0, headerEnd + 4 + contentLength);
+        sendNext();
+    }
+
+public:
+    LoadClient(const QList<QByteArray>& paths, LoadStats& stats, int first) :
+        m_paths(paths),
+        m_stats(stats),
+        m_next(first % paths.count())
+    {
+        m_socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        QObject::connect(&m_socket, &QTcpSocket::connected, [this]() { sendNext(); });
+        QObject::connect(&m_socket, &QTcpSocket::readyRead, [this]() { onReadyRead(); });
+    }
+
+    void start(int port)
+    {
+        m_socket.connectToHost("127.0.0.1", port);
+    }
+};
+
+static double percentileMs(const QVector<qint64>& sorted, double fraction)
+{
+    if (sorted.isEmpty()) return 0;
+    int index = qBound(0, (int)ceil(fraction * sorted.count()) - 1, sorted.count() - 1);
+    return sorted[index] / 1000000.0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int port = DEFAULT_PORT;
+    int clientCount = DEFAULT_CLIENTS;
+    int seconds = DEFAULT_SECONDS;
+    QString pathsFile;
+    QStringList arguments = app.arguments();
+    arguments.removeFirst();
+    while (!arguments.isEmpty()) {
+        QString option = arguments.takeFirst();
+        if ((option == "--port") && !arguments.isEmpty()) {
+            port = arguments.takeFirst().toInt();
+        } else if ((option == "--clients") && !arguments.isEmpty()) {
+            clientCount = qMax(1, arguments.takeFirst().toInt());
+        } else if ((option == "--seconds") && !arguments.isEmpty()) {
+            seconds = qMax(1, arguments.takeFirst().toInt());
+        } else if ((option == "--paths") && !arguments.isEmpty()) {
+            pathsFile = arguments.takeFirst();
+        } else {
+            fprintf(stderr, "unknown option %s\n", option.toUtf8().constData());
+            return 1;
+        }
+    }
+
+    QList<QByteArray> paths;
+    if (pathsFile.isEmpty()) {
+        int i;
+        for (i=0; s_defaultPaths[i] != NULL; i++) {
+            paths.append(s_defaultPaths[i]);
+        }
+    } else {
+        QFile file(pathsFile);
+        if (!file.open(QIODevice::ReadOnly)) {
+            fprintf(stderr, "could not open %s\n", pathsFile.toUtf8().constData());
+            return 1;
+        }
+        while (!file.atEnd()) {
+            QByteArray line = file.readLine().trimmed();
+            if (!line.isEmpty()) paths.append(line);
+        }
+        if (paths.isEmpty()) {
+            fprintf(stderr, "no paths in %s\n", pathsFile.toUtf8().constData());
+            return 1;
+        }
+    }
+
+    LoadStats stats;
+    stats.errors = 0;
+    stats.running = true;
+
+    QList<LoadClient*> clients;
+    int i;
+    for (i=0; i < clientCount; i++) {
+        LoadClient* client = new LoadClient(paths, stats, i);
+        clients.append(client);
+        client->start(port);
+    }
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    QTimer::singleShot(seconds * 1000, [&]() {
+        stats.running = false;
+        app.quit();
+    });
+    app.exec();
+    double elapsedSeconds = elapsed.nsecsElapsed() / 1000000000.0;
+    qDeleteAll(clients);
+
+    QVector<qint64> sorted = stats.latencies;
+    std::sort(sorted.begin(), sorted.end());
+    qint64 total = 0;
+    for (i=0; i < sorted.count(); i++) {
+        total += sorted[i];
+    }
+
+    printf("%d requests (%d errors) in %.1fs from %d clients\n",
+           sorted.count(), stats.errors, elapsedSeconds, clientCount);
+    printf("%.0f requests/sec\n", sorted.count() / elapsedSeconds);
+    printf("latency ms: mean %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+           sorted.isEmpty() ? 0 : total / 1000000.0 / sorted.count(),
+           percentileMs(sorted, 0.5), percentileMs(sorted, 0.9),
+           percentileMs(sorted, 0.99), percentileMs(sorted, 1.0));
+    return sorted.isEmpty() ? 1 : 0;
+}
@@ -0,0 +1,289 @@
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QUrl>
+#include <QtConcurrent>
+
+#include "dictserver.h"
+#include "dictdb.h"
+
+//a request whose headers are longer than this is refused
+#define MAX_REQUEST_HEADER_LENGTH 16384
+//only GET is supported, so a body is only ever read past
+#define MAX_REQUEST_BODY_LENGTH 65536
+
+DictDbPool::DictDbPool(const QString& dbPath, int size, DetailsCache* detailsCache) :
+    m_detailsCache(detailsCache)
+{
+    int i;
+    for (i=0; i < size; i++) {
+        DictDb* dictDb = new DictDb(dbPath);
+        dictDb->setDetailsCache(detailsCache);
+        m_all.append(dictDb);
+        m_free.append(dictDb);
+    }
+    m_available.release(size);
+}
+
+DictDbPool::~DictDbPool()
+{
+    qDeleteAll(m_all);
+}
+
+DictDb* DictDbPool::acquire()
+{
+    m_available.acquire();
+    QMutexLocker locker(&m_mutex);
+    return m_free.takeLast();
+}
+
+void DictDbPool::release(DictDb* dictDb)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_free.append(dictDb);
+    }
+    m_available.release();
+}
+
+static HttpResponse makeResponse(int status, const QByteArray& body)
+{
+    HttpResponse response;
+    response.status = status;
+    response.body = body;
+    return response;
+}
+
+static HttpResponse errorResponse(int status, const QString& message)
+{
+    QJsonObject object;
+    object.insert("error", message);
+    return makeResponse(status, QJsonDocument(object).toJson(QJsonDocument::Compact));
+}
+
+static HttpResponse searchResponse(DictDbPool* pool, const QUrlQuery& query)
+{
+    QString search = query.queryItemValue("q", QUrl::FullyDecoded);
+    QString mode = query.queryItemValue("mode");
+    if (mode.isEmpty()) mode = "chinese";
+    if ((mode != "chinese") && (mode != "english")) {
+        return errorResponse(400, "mode must be chinese or english");
+    }
+
+    DictDb* dictDb = pool->acquire();
+    QObjectList* results = (mode == "english") ? dictDb->matchEnglish(search) : dictDb->matchChinese(search);
+    pool->release(dictDb);
+
+    QJsonArray array = QJsonArray::fromVariantList(DictDb::resultsPayload(results));
+    qDeleteAll(*results);
+    delete results;
+
+    QJsonObject object;
+    object.insert("search", search);
+    object.insert("mode", mode);
+    object.insert("results", array);
+    return makeResponse(200, QJsonDocument(object).toJson(QJsonDocument::Compact));
+}
+
+//the details endpoints send the same data DictDb gives the details page
+static HttpResponse detailsResponse(DictDbPool* pool, const QString& path, const QUrlQuery& query)
+{
+    bool ok;
+    int wordsKey = query.queryItemValue("wordsKey").toInt(&ok);
+    if (!ok) return errorResponse(400, "wordsKey must be a number");
+
+    int parts = DictDb::AllDetailsParts;
+    if (path == "/classifiers") parts = DictDb::ClassifiersPart;
+    if (path == "/components") parts = DictDb::ComponentsPart;
+
+    DetailsPayload details;
+    DictDb* dictDb = pool->acquire();
+    bool found = dictDb->requestDetails(wordsKey, details, parts);
+    pool->release(dictDb);
+    if (!found) return errorResponse(404, "no such wordsKey");
+
+    QJsonDocument document;
+    if (path == "/classifiers") {
+        document.setArray(QJsonArray::fromVariantList(details.classifiers));
+    } else if (path == "/components") {
+        document.setArray(QJsonArray::fromVariantList(details.components));
+    } else {
+        QJsonObject object = QJsonObject::fromVariantMap(details.toVariantMap());
+        object.insert("wordsKey", wordsKey);
+        document.setObject(object);
+    }
+    return makeResponse(200, document.toJson(QJsonDocument::Compact));
+}
+
+static HttpResponse statsResponse(DictDbPool* pool)
+{
+    DetailsCache* cache = pool->detailsCache();
+    QJsonObject object;
+    object.insert("connections", pool->size());
+    object.insert("cacheEntries", cache->count());
+    object.insert("cacheBytes", cache->bytes());
+    object.insert("cacheMaxBytes", cache->maxBytes());
+    object.insert("cacheHits", (double)cache->hits());
+    object.insert("cacheMisses", (double)cache->misses());
+    return makeResponse(200, QJsonDocument(object).toJson(QJsonDocument::Compact));
+}
+
+HttpResponse DictServer::handleRequest(DictDbPool* pool, const QString& path, const QUrlQuery& query)
+{
+    if (path == "/search") return searchResponse(pool, query);
+    if (path == "/stats") return statsResponse(pool);
+    if ((path == "/details") || (path == "/classifiers") || (path == "/components")) {
+        return detailsResponse(pool, path, query);
+    }
+    return errorResponse(404, "unknown path " + path);
+}
+
+DictServer::DictServer(const QString& dbPath, int connections, int cacheBytes) :
+    m_detailsCache(cacheBytes),
+    m_pool(dbPath, connections, &m_detailsCache)
+{
+    //one query thread per connection, so acquire() never has to wait
+    m_threadPool.setMaxThreadCount(connections);
+}
+
+void DictServer::incomingConnection(qintptr socketDescriptor)
+{
+    QTcpSocket* socket = new QTcpSocket;
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        delete socket;
+        return;
+    }
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    HttpConnection* connection = new HttpConnection(socket, &m_pool, &m_threadPool);
+    connection->setParent(this);
+}
+
+HttpConnection::HttpConnection(QTcpSocket* socket, DictDbPool* pool, QThreadPool* threadPool) :
+    m_socket(socket),
+    m_pool(pool),
+    m_threadPool(threadPool),
+    m_busy(false),
+    m_closeAfterResponse(false)
+{
+    m_socket->setParent(this);
+    connect(m_socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(m_socket, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    connect(&m_watcher, SIGNAL(finished()), this, SLOT(onResponseReady()));
+}
+
+void HttpConnection::onReadyRead()
+{
+    m_buffer.append(m_socket->readAll());
+    processBuffer();
+}
+
+void HttpConnection::onDisconnected()
+{
+    //a query still running just has its result dropped
+    deleteLater();
+}
+
+//starts the next complete request in the buffer, if not already answering one
+void HttpConnection::processBuffer()
+{
+    if (m_busy || m_closeAfterResponse) return;
+
+    int headerEnd = m_buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        if (m_buffer.length() > MAX_REQUEST_HEADER_LENGTH) {
+            m_closeAfterResponse = true;
+            writeResponse(errorResponse(431, "request header too long"));
+        }
+        return;
+    }
+
+    QList<QByteArray> lines = m_buffer.left(headerEnd).split('\n');
+    QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    int contentLength = 0;
+    bool contentLengthOk = true;
+    bool keepAlive = (requestLine.count() == 3) && (requestLine[2] == "HTTP/1.1");
+    int i;
+    for (i=1; i < lines.count(); i++) {
+        QByteArray line = lines[i].trimmed();
+        int colon = line.indexOf(':');
+        if (colon < 0) continue;
+        QByteArray name = line.left(colon).trimmed().toLower();
+        QByteArray value = line.mid(colon + 1).trimmed().toLower();
+        if (name == "content-length") {
+            contentLength = value.toInt(&contentLengthOk);
+            if (!contentLengthOk || (contentLength < 0) || (contentLength > MAX_REQUEST_BODY_LENGTH)) {
+                contentLengthOk = false;
+                break;
+            }
+        }
+        if (name == "connection") keepAlive = (value == "keep-alive");
+    }
+
+    if (!contentLengthOk) {
+        //we can't tell where the next request would start
+        m_buffer.clear();
+        m_closeAfterResponse = true;
+        writeResponse(errorResponse(400, "bad Content-Length"));
+        return;
+    }
+
+    int requestLength = headerEnd + 4 + contentLength;
+    if (m_buffer.length() < requestLength) return;
+    m_buffer.remove(0, requestLength);
+    m_closeAfterResponse = !keepAlive;
+
+    if (requestLine.count() != 3) {
+        m_closeAfterResponse = true;
+        writeResponse(errorResponse(400, "bad request line"));
+        return;
+    }
+    if (requestLine[0] != "GET") {
+        writeResponse(errorResponse(405, "only GET is supported"));
+        return;
+    }
+
+    //QUrlQuery doesn't treat '+' as a space, as html forms do
+    QByteArray target = requestLine[1];
+    target.replace('+', "%20");
+    QUrl url = QUrl::fromEncoded(target);
+    m_busy = true;
+    m_watcher.setFuture(QtConcurrent::run(m_threadPool, &DictServer::handleRequest,
+                                          m_pool, url.path(), QUrlQuery(url)));
+}
+
+void HttpConnection::onResponseReady()
+{
+    m_busy = false;
+    writeResponse(m_watcher.result());
+}
+
+static QByteArray reasonPhrase(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 431: return "Request Header Fields Too Large";
+    }
+    return "Error";
+}
+
+void HttpConnection::writeResponse(const HttpResponse& response)
+{
+    QByteArray data = "HTTP/1.1 " + QByteArray::number(response.status) + " " + reasonPhrase(response.status) + "\r\n";
+    data += "Content-Type: application/json; charset=utf-8\r\n";
+    data += "Content-Length: " + QByteArray::number(response.body.length()) + "\r\n";
+    data += m_closeAfterResponse ? "Connection: close\r\n" : "Connection: keep-alive\r\n";
+    data += "\r\n";
+    data += response.body;
+    m_socket->write(data);
+
+    if (m_closeAfterResponse) {
+        m_socket->disconnectFromHost();
+        return;
+    }
+    processBuffer();
+}
@@ -0,0 +1,98 @@
+#ifndef DICTSERVER_H
+#define DICTSERVER_H
+
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSemaphore>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThreadPool>
+#include <QUrlQuery>
+
+#include "detailscache.h"
+
+class DictDb;
+
+struct HttpResponse {
+    int status;
+    QByteArray body;
+};
+
+//a fixed set of DictDb instances, each with its own read only connection.
+//a query thread takes one for the length of a request
+class DictDbPool
+{
+private:
+    QList<DictDb*> m_free;
+    QList<DictDb*> m_all;
+    QMutex m_mutex;
+    QSemaphore m_available;
+    DetailsCache* m_detailsCache;
+
+public:
+    //every DictDb shares detailsCache
+    DictDbPool(const QString& dbPath, int size, DetailsCache* detailsCache);
+    ~DictDbPool();
+
+    int size() const { return m_all.count(); }
+    DetailsCache* detailsCache() const { return m_detailsCache; }
+
+    DictDb* acquire();
+    void release(DictDb* dictDb);
+};
+
+//one keep-alive client. requests are answered one at a time, in order
+class HttpConnection : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTcpSocket* m_socket;
+    DictDbPool* m_pool;
+    QThreadPool* m_threadPool;
+    QByteArray m_buffer;
+    QFutureWatcher<HttpResponse> m_watcher;
+    bool m_busy;
+    bool m_closeAfterResponse;
+
+    void processBuffer();
+    void writeResponse(const HttpResponse& response);
+
+public:
+    HttpConnection(QTcpSocket* socket, DictDbPool* pool, QThreadPool* threadPool);
+
+private slots:
+    void onReadyRead();
+    void onResponseReady();
+    void onDisconnected();
+};
+
+//answers GET requests on localhost with json:
+//  /search?q=<text>&mode=chinese|english
+//  /details?wordsKey=<n>
+//  /classifiers?wordsKey=<n>
+//  /components?wordsKey=<n>
+//  /stats  (the details cache)
+class DictServer : public QTcpServer
+{
+    Q_OBJECT
+
+private:
+    DetailsCache m_detailsCache;
+    DictDbPool m_pool;
+    QThreadPool m_threadPool;
+
+protected:
+    void incomingConnection(qintptr socketDescriptor);
+
+public:
+    DictServer(const QString& dbPath, int connections, int cacheBytes);
+
+    //runs on a query thread
+    static HttpResponse handleRequest(DictDbPool* pool, const QString& path, const QUrlQuery& query);
+};
+
+#endif // DICTSERVER_H
@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <QCoreApplication>
+#include <QHostAddress>
+#include <QStringList>
+#include <QThread>
+#include "dictserver.h"
+
+#define DB_FILE "words.db"
+#define DEFAULT_PORT 8765
+#define DEFAULT_CACHE_MB 32
+
+//serves dictionary searches and details as json to other local programs.
+//usage: ChineseDictServer [--db words.db] [--port 8765] [--connections n] [--cache-mb 32]
+//each of the n query threads has its own read only connection to the db,
+//and they share one cache of details. it only listens on localhost
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QString dbPath = DB_FILE;
+    int port = DEFAULT_PORT;
+    int connections = QThread::idealThreadCount();
+    int cacheMb = DEFAULT_CACHE_MB;
+    QStringList arguments = app.arguments();
+    arguments.removeFirst();
+    while (!arguments.isEmpty()) {
+        QString option = arguments.takeFirst();
+        if ((option == "--db") && !arguments.isEmpty()) {
+            dbPath = arguments.takeFirst();
+        } else if ((option == "--port") && !arguments.isEmpty()) {
+            port = arguments.takeFirst().toInt();
+        } else if ((option == "--connections") && !arguments.isEmpty()) {
+            connections = qMax(1, arguments.takeFirst().toInt());
+        } else if ((option == "--cache-mb") && !arguments.isEmpty()) {
+            cacheMb = qMax(0, arguments.takeFirst().toInt());
+        } else {
+            fprintf(stderr, "unknown option %s\n", option.toUtf8().constData());
+            return 1;
+        }
+    }
+
+    DictServer server(dbPath, connections, cacheMb * 1024 * 1024);
+    if (!server.listen(QHostAddress::LocalHost, port)) {
+        fprintf(stderr, "could not listen on port %d: %s\n", port,
+                server.errorString().toUtf8().constData());
+        return 1;
+    }
+    fprintf(stderr, "listening on http://127.0.0.1:%d with %d connections to %s\n",
+            port, connections, dbPath.toUtf8().constData());
+
+    return app.exec();
+}
@@ -0,0 +1,23 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG += c++14
+# debug output, see logging.h, is compiled out of release builds
+CONFIG(release, debug|release): DEFINES += QT_NO_DEBUG_OUTPUT
+# where queries.txt is, and data/ relative to it
+DEFINES += BENCH_SOURCE_DIR=\\\"$$PWD\\\"
+
+QT += core
+
+INCLUDEPATH += ../../app/ChineseDictApp
+
+SOURCES += \
+    ../../app/ChineseDictApp/textutils.cpp \
+    ../../app/ChineseDictApp/pinyinsyllables.cpp \
+    ../../app/ChineseDictApp/logging.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../app/ChineseDictApp/textutils.h \
+    ../../app/ChineseDictApp/pinyinsyllables.h \
+    ../../app/ChineseDictApp/logging.h
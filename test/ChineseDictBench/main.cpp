@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <atomic>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QStringList>
+#include "textutils.h"
+#include "pinyinsyllables.h"
+
+//BENCH_SOURCE_DIR is set in the .pro, so the defaults work from a shadow build
+#define CEDICT_FILE BENCH_SOURCE_DIR "/../../data/cedict_ts.u8"
+#define QUERIES_FILE BENCH_SOURCE_DIR "/queries.txt"
+#define DEFAULT_MIN_MS 300
+
+//times the textutils functions that run per keystroke or per cedict entry,
+//reporting ns per call, heap allocations per call and throughput.
+//usage: ChineseDictBench [--cedict cedict_ts.u8] [--queries queries.txt]
+//                        [--min-ms 300] [--filter name] [--label text] [--json out.jsonl]
+//the pinyin corpus is the [pinyin] field of every cedict entry, and the query
+//corpus is a search log, one search per line. --json appends one json object
+//per benchmark, tagged with --label (e.g. a commit hash), for comparing runs
+
+//counts every malloc, calloc and realloc in the process, including Qt's,
+//by standing in for glibc's. elsewhere allocations aren't reported
+#ifdef __GLIBC__
+#define COUNTS_ALLOCATIONS
+static std::atomic<unsigned long long> s_allocations(0);
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+extern "C" void* malloc(size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+static unsigned long long allocationCount() { return s_allocations.load(std::memory_order_relaxed); }
+#else
+static unsigned long long allocationCount() { return 0; }
+#endif
+
+//used when there is no cedict file
+static const char* s_fallbackPinyin[] = {
+    "zhong1 guo2", "zhong1 guo2 ren2", "ni3 hao3", "xue2 sheng5", "Ai4 er3 lan2",
+    "shi2 tou5 , jian3 zi5 bu4", "lu:4 se4", "nu:3 er2", "Yi1 long2 · Ma3 si1 ke4",
+    "jia4 lian2 wu4 mei3", "chuang1 hu5", "xiong2 mao1", "zhuang4 kuang4", "qu4 nian2",
+    "san1 Q", "V C R", "ka3 la1 O K", "yi1 lu4 ping2 an1", "Xi1 an1", "hao3 jiu3 bu4 jian4",
+    NULL
+};
+
+//the results are added up into here so the calls can't be optimised away
+static volatile int s_sink;
+
+struct Corpus {
+    QString name;
+    QStringList items;
+    qint64 utf8Bytes;
+};
+
+struct BenchResult {
+    QString name;
+    QString corpus;
+    qint64 calls;
+    double nsPerCall;
+    double allocationsPerCall;
+    double callsPerSecond;
+    double mbPerSecond;     //of utf-8 input
+};
+
+static Corpus makeCorpus(const QString& name, const QStringList& items)
+{
+    Corpus corpus;
+    corpus.name = name;
+    corpus.items = items;
+    corpus.utf8Bytes = 0;
+    int i;
+    for (i=0; i < items.count(); i++) {
+        corpus.utf8Bytes += items.at(i).toUtf8().length();
+    }
+    return corpus;
+}
+
+//the numbered pinyin between [ and ] on each line of a cedict file
+static bool loadCedictPinyin(const QString& path, QStringList& pinyin)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    while (!file.atEnd()) {
+        QString line = QString::fromUtf8(file.readLine());
+        if (line.startsWith('#')) continue;
+        int start = line.indexOf('[');
+        int end = line.indexOf(']', start + 1);
+        if ((start < 0) || (end < 0)) continue;
+        pinyin.append(line.mid(start + 1, end - start - 1));
+    }
+    return !pinyin.isEmpty();
+}
+
+static bool loadLines(const QString& path, QStringList& lines)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    while (!file.atEnd()) {
+        QString line = QString::fromUtf8(file.readLine()).trimmed();
+        if (!line.isEmpty()) lines.append(line);
+    }
+    return !lines.isEmpty();
+}
+
+//every syllable of the pinyin corpus, without its tone number
+static QStringList tonelessSyllables(const QStringList& pinyin)
+{
+    QStringList syllables;
+    int i;
+    for (i=0; i < pinyin.count(); i++) {
+        QStringList words = pinyin.at(i).split(' ', QString::SkipEmptyParts);
+        int j;
+        for (j=0; j < words.count(); j++) {
+            QString syllable = words.at(j);
+            if ((syllable.length() > 1) && syllable.at(syllable.length() - 1).isDigit()) syllable.chop(1);
+            syllables.append(syllable);
+        }
+    }
+    return syllables;
+}
+
+//calls function on every item of the corpus, once to warm up and then
+//over and over until minMs have gone by
+template <typename Function>
+static BenchResult runBench(const QString& name, const Corpus& corpus, int minMs, Function function)
+{
+    int i;
+    int sum = 0;
+    for (i=0; i < corpus.items.count(); i++) sum += function(corpus.items.at(i));
+
+    qint64 passes = 0;
+    qint64 elapsedNs = 0;
+    unsigned long long allocations = allocationCount();
+    QElapsedTimer timer;
+    timer.start();
+    do {
+        for (i=0; i < corpus.items.count(); i++) sum += function(corpus.items.at(i));
+        passes++;
+        elapsedNs = timer.nsecsElapsed();
+    } while (elapsedNs < (qint64)minMs * 1000000);
+    allocations = allocationCount() - allocations;
+    s_sink = sum;
+
+    BenchResult result;
+    result.name = name;
+    result.corpus = corpus.name;
+    result.calls = passes * corpus.items.count();
+    result.nsPerCall = (double)elapsedNs / result.calls;
+    result.allocationsPerCall = (double)allocations / result.calls;
+    result.callsPerSecond = result.calls * 1e9 / elapsedNs;
+    result.mbPerSecond = (passes * corpus.utf8Bytes) / (elapsedNs / 1e9) / (1024.0 * 1024.0);
+    return result;
+}
+
+static QJsonObject resultJson(const BenchResult& result, const QString& label)
+{
+    QJsonObject object;
+    object.insert("label", label);
+    object.insert("benchmark", result.name);
+    object.insert("corpus", result.corpus);
+    object.insert("calls", (double)result.calls);
+    object.insert("nsPerCall", result.nsPerCall);
+#ifdef COUNTS_ALLOCATIONS
+    object.insert("allocationsPerCall", result.allocationsPerCall);
+#endif
+    object.insert("callsPerSecond", result.callsPerSecond);
+    object.insert("mbPerSecond", result.mbPerSecond);
+    return object;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    //parseCedictEntry() logs every entry in debug builds
+    QLoggingCategory::setFilterRules("chinesedict.*.debug=false");
+
+    QString cedictPath = CEDICT_FILE;
+    QString queriesPath = QUERIES_FILE;
+    QString filter;
+    QString label;
+    QString jsonPath;
+    int minMs = DEFAULT_MIN_MS;
+    QStringList arguments = app.arguments();
+    arguments.removeFirst();
+    while (!arguments.isEmpty()) {
+        QString option = arguments.takeFirst();
+        if ((option == "--cedict") && !arguments.isEmpty()) {
+            cedictPath = arguments.takeFirst();
+        } else if ((option == "--queries") && !arguments.isEmpty()) {
+            queriesPath = arguments.takeFirst();
+        } else if ((option == "--min-ms") && !arguments.isEmpty()) {
+            minMs = qMax(1, arguments.takeFirst().toInt());
+        } else if ((option == "--filter") && !arguments.isEmpty()) {
+            filter = arguments.takeFirst();
+        } else if ((option == "--label") && !arguments.isEmpty()) {
+            label = arguments.takeFirst();
+        } else if ((option == "--json") && !arguments.isEmpty()) {
+            jsonPath = arguments.takeFirst();
+        } else {
+            fprintf(stderr, "unknown option %s\n", option.toUtf8().constData());
+            return 1;
+        }
+    }
+
+#ifndef QT_NO_DEBUG
+    fprintf(stderr, "warning: this is a debug build, the numbers won't match a release build\n");
+#endif
+
+    QStringList pinyin;
+    if (!loadCedictPinyin(cedictPath, pinyin)) {
+        fprintf(stderr, "could not read %s, using a few built in entries\n", cedictPath.toUtf8().constData());
+        int i;
+        for (i=0; s_fallbackPinyin[i] != NULL; i++) pinyin.append(QString::fromUtf8(s_fallbackPinyin[i]));
+    }
+    QStringList queryLines;
+    if (!loadLines(queriesPath, queryLines)) {
+        fprintf(stderr, "could not read %s\n", queriesPath.toUtf8().constData());
+        return 1;
+    }
+    Corpus cedict = makeCorpus("cedict", pinyin);
+    Corpus queries = makeCorpus("queries", queryLines);
+    Corpus syllables = makeCorpus("syllables", tonelessSyllables(pinyin));
+
+    //the buffers the buffer based functions append to, reused for every call
+    QString display, tonemarked, toneless, toneNums, components, out;
+    QString initials, syllablePinyin, fuzzy;
+    PinyinSearchQueries pinyinQueries;
+    QByteArray utf8;
+
+    QList<BenchResult> results;
+    //the body is variadic as it will usually have commas in it
+    #define BENCH(name, corpus, ...) \
+        if (filter.isEmpty() || QString(name).contains(filter)) \
+            results.append(runBench(name, corpus, minMs, [&](const QString& text) -> int __VA_ARGS__))
+
+    BENCH("determineTextFormat", queries, { return determineTextFormat(text); });
+    BENCH("classifyText", queries, { return classifyText(text); });
+    BENCH("makeTonelessSearchPinyin", queries, { return makeTonelessSearchPinyin(text).length(); });
+    BENCH("appendTonelessSearchPinyin", queries, {
+        clearBuffer(out);
+        appendTonelessSearchPinyin(text.constData(), text.length(), out);
+        return out.length();
+    });
+    BENCH("splitTonelessSyllables", queries, { return splitTonelessSyllables(text).count(); });
+    BENCH("segmentPinyin", queries, {
+        PinyinSegmentation alternatives[4];
+        return segmentPinyin(text, alternatives, 4);
+    });
+    BENCH("makeToneMarkedSearchPinyin", cedict, { return makeToneMarkedSearchPinyin(text).length(); });
+    BENCH("appendToneMarkedSearchPinyin", cedict, {
+        clearBuffer(out);
+        appendToneMarkedSearchPinyin(text.constData(), text.length(), out);
+        return out.length();
+    });
+    BENCH("makeDisplayPinyin", cedict, { return makeDisplayPinyin(text).length(); });
+    BENCH("parseCedictEntry", cedict, {
+        QString d, m, l, t, c;
+        parseCedictEntry(text, d, m, l, t, c);
+        return d.length();
+    });
+    BENCH("parseCedictEntry/buffers", cedict, {
+        parseCedictEntry(text.constData(), text.length(), display, tonemarked, toneless, toneNums, components);
+        return display.length();
+    });
+    //what dbcreator makes of every entry's pinyin, besides parseCedictEntry()
+    BENCH("cedictSearchForms/buffers", cedict, {
+        parseCedictEntry(text.constData(), text.length(), display, tonemarked, toneless, toneNums, components);
+        clearBuffer(initials);
+        appendInitialsSearchPinyin(components.constData(), components.length(), initials);
+        clearBuffer(syllablePinyin);
+        appendSyllableSearchPinyin(components.constData(), components.length(), syllablePinyin);
+        clearBuffer(fuzzy);
+        appendFuzzySearchPinyin(syllablePinyin.constData(), syllablePinyin.length(), fuzzy);
+        setUtf8(fuzzy.constData(), fuzzy.length(), utf8);
+        return initials.length() + utf8.length();
+    });
+    //everything DictDb::matchChinese() does for a pinyin keystroke before sqlite runs the queries
+    BENCH("pinyinSearchQueries", queries, {
+        textFormat_t textFormat = determineTextFormat(text);
+        if ((textFormat == tfHanzi) || (textFormat == tfMixed)) return 0;
+        makePinyinSearchQueries(text, textFormat, true, pinyinQueries);
+        setUtf8(pinyinQueries.pinyin.constData(), pinyinQueries.pinyin.length(), utf8);
+        int length = utf8.length();
+        setUtf8(pinyinQueries.syllables.constData(), pinyinQueries.syllables.length(), utf8);
+        length += utf8.length();
+        setUtf8(pinyinQueries.fuzzy.constData(), pinyinQueries.fuzzy.length(), utf8);
+        return length + utf8.length();
+    });
+    //placing the tone mark, as _insertToneMark() does for every syllable
+    BENCH("findToneMarkPosition", syllables, { return findToneMarkPosition(text.constData(), text.length()); });
+
+    QFile json(jsonPath);
+    if (!jsonPath.isEmpty() && !json.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        fprintf(stderr, "could not open %s\n", jsonPath.toUtf8().constData());
+        return 1;
+    }
+
+    printf("%-30s %-10s %12s %12s %14s %10s\n", "benchmark", "corpus", "ns/call", "allocs/call", "calls/s", "MB/s");
+    int i;
+    for (i=0; i < results.count(); i++) {
+        const BenchResult& result = results.at(i);
+#ifdef COUNTS_ALLOCATIONS
+        QByteArray allocations = QByteArray::number(result.allocationsPerCall, 'f', 2);
+#else
+        QByteArray allocations = "n/a";
+#endif
+        printf("%-30s %-10s %12.1f %12s %14.0f %10.2f\n", result.name.toUtf8().constData(),
+               result.corpus.toUtf8().constData(), result.nsPerCall, allocations.constData(),
+               result.callsPerSecond, result.mbPerSecond);
+        if (json.isOpen()) {
+            json.write(QJsonDocument(resultJson(result, label)).toJson(QJsonDocument::Compact) + "\n");
+        }
+    }
+
+    //these reuse their buffers, so once warmed up they must not allocate
+    int failures = 0;
+#ifdef COUNTS_ALLOCATIONS
+    QStringList allocationFree;
+    allocationFree << "determineTextFormat" << "classifyText" << "appendTonelessSearchPinyin"
+                   << "segmentPinyin" << "appendToneMarkedSearchPinyin" << "parseCedictEntry/buffers"
+                   << "cedictSearchForms/buffers" << "pinyinSearchQueries" << "findToneMarkPosition";
+    for (i=0; i < results.count(); i++) {
+        const BenchResult& result = results.at(i);
+        if (allocationFree.contains(result.name) && (result.allocationsPerCall > 0)) {
+            fprintf(stderr, "error: %s allocates %.2f times per call, expected none\n",
+                    result.name.toUtf8().constData(), result.allocationsPerCall);
+            failures++;
+        }
+    }
+#endif
+    return (failures > 0) ? 1 : 0;
+}
@@ -9,15 +9,39 @@ CONFIG += thread
 CONFIG += testcase #Creates 'check' target in Makefile.
 CONFIG += console
 
-QT += core
-CONFIG += c++11
+QT += core concurrent
+CONFIG += c++14
+# debug output, see logging.h, is compiled out of release builds
+CONFIG(release, debug|release): DEFINES += QT_NO_DEBUG_OUTPUT
 INCLUDEPATH += ../../app/ChineseDictApp
+INCLUDEPATH += ../../dbcreator/ChineseDictDbCreator
+INCLUDEPATH += ../../sqlite-amalgamation-3220000
 
 HEADERS +=     tst_pinyinutils.h \
     tst_pinyinutils.h \
     ../../sqlite-amalgamation-3220000/sqlite3.h \
-    ../../app/ChineseDictApp/textutils.h
+    ../../app/ChineseDictApp/textutils.h \
+    ../../app/ChineseDictApp/pinyinsyllables.h \
+    ../../app/ChineseDictApp/logging.h \
+    ../../app/ChineseDictApp/headwordindex.h \
+    ../../app/ChineseDictApp/detailscache.h \
+    ../../app/ChineseDictApp/segmenter.h \
+    ../../app/ChineseDictApp/qobjectlistmodel.h \
+    ../../app/ChineseDictApp/englishsearch.h \
+    ../../app/ChineseDictApp/dictdb.h \
+    ../../app/ChineseDictApp/batchlookup.h \
+    ../../dbcreator/ChineseDictDbCreator/dbcreator.h
 
 SOURCES +=     main.cpp \
     ../../sqlite-amalgamation-3220000/sqlite3.c \
-    ../../app/ChineseDictApp/textutils.cpp
+    ../../app/ChineseDictApp/textutils.cpp \
+    ../../app/ChineseDictApp/pinyinsyllables.cpp \
+    ../../app/ChineseDictApp/logging.cpp \
+    ../../app/ChineseDictApp/headwordindex.cpp \
+    ../../app/ChineseDictApp/detailscache.cpp \
+    ../../app/ChineseDictApp/segmenter.cpp \
+    ../../app/ChineseDictApp/qobjectlistmodel.cpp \
+    ../../app/ChineseDictApp/englishsearch.cpp \
+    ../../app/ChineseDictApp/dictdb.cpp \
+    ../../app/ChineseDictApp/batchlookup.cpp \
+    ../../dbcreator/ChineseDictDbCreator/dbcreator.cpp
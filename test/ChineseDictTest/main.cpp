@@ -1,8 +1,20 @@
 #include "tst_pinyinutils.h"
 
+#include <stdio.h>
 #include <gtest/gtest.h>
 #include "textutils.h"
+#include "headwordindex.h"
+#include "segmenter.h"
+#include "detailscache.h"
+#include "dictdb.h"
+#include "batchlookup.h"
+#include "dbcreator.h"
+#include "pinyinsyllables.h"
+#include <QCoreApplication>
 #include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QRegularExpression>
 
 
 int main(int argc, char *argv[])
@@ -25,6 +37,16 @@ TEST(PinyinUtils, determineTextFormat) {
     ASSERT_EQ(tfPinyinTonemarks, determineTextFormat(u8"LÜĒ"));
     ASSERT_EQ(tfPinyinTonemarks, determineTextFormat(u8"shì"));
     ASSERT_EQ(tfPinyinTonemarks, determineTextFormat(u8"shì shi"));
+    ASSERT_EQ(tfPinyinInitials, determineTextFormat("zg"));
+    ASSERT_EQ(tfPinyinInitials, determineTextFormat("XXS"));
+    ASSERT_EQ(tfPinyinInitials, determineTextFormat(" zg "));
+    ASSERT_EQ(tfPinyinNoTones, determineTextFormat("x x s"));
+    ASSERT_EQ(tfPinyinNoTones, determineTextFormat("zh g"));
+    ASSERT_EQ(tfPinyinNoTones, determineTextFormat("z"));
+    ASSERT_EQ(tfPinyinInitials, determineTextFormat("zhg"));
+    ASSERT_EQ(tfPinyinNoTones, determineTextFormat("zhong g"));
+    ASSERT_EQ(tfMixed, determineTextFormat(u8"中guo"));
+    ASSERT_EQ(tfMixed, determineTextFormat(u8"zhong国"));
 }
 
 QString extractToneNumbers(const QString& source)
@@ -142,3 +164,670 @@ TEST(PinyinUtils, interesting) {
 
 }
 
+
+TEST(PinyinUtils, buffers) {
+    QString displayPinyin, tonemarkedSearchPinyin, tonelessSearchPinyin, toneNums, componentPinyin;
+    const char* sources[] = { "Ai4 er3 lan2", "shi2 tou5 , jian3 zi5 bu4", "lu:4 se4", "Yi1 long2 · Ma3 si1 ke4", "3 Q", "" };
+    uint i;
+    for (i=0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        QString source = QString::fromUtf8(sources[i]);
+        //the buffers are reused, and cleared by each call
+        parseCedictEntry(source.constData(), source.length(), displayPinyin, tonemarkedSearchPinyin,
+                         tonelessSearchPinyin, toneNums, componentPinyin);
+        ASSERT_EQ(makeDisplayPinyin(source), displayPinyin);
+        ASSERT_EQ(makeToneMarkedSearchPinyin(source), tonemarkedSearchPinyin);
+        ASSERT_EQ(makeTonelessSearchPinyin(source), tonelessSearchPinyin);
+        ASSERT_EQ(toneNums.count(','), componentPinyin.count(','));
+    }
+
+    //the append functions add to what is there, and read part of a string
+    QString out = "x";
+    QString words = "zhong1 guo2 ren2";
+    appendToneMarkedSearchPinyin(words.constData(), 11, out);
+    ASSERT_EQ(u8"xzhōngguó", out);
+    appendTonelessSearchPinyin(words.constData() + 12, 4, out);
+    ASSERT_EQ(u8"xzhōngguóren", out);
+    out = "Ài";
+    appendDisplayPinyin(words.constData(), 11, out);
+    ASSERT_EQ(u8"Àizhōng guó", out);
+}
+
+TEST(PinyinUtils, fuzzy) {
+    ASSERT_EQ(u8"zonguo", makeFuzzySearchPinyin("zhong1 guo2"));
+    ASSERT_EQ(u8"zonguo", makeFuzzySearchPinyin("zongguo"));
+    ASSERT_EQ(u8"zonguo", makeFuzzySearchPinyin("ZHONGGUO"));
+    ASSERT_EQ(makeFuzzySearchPinyin("ci2 shan4"), makeFuzzySearchPinyin("chishan"));
+    ASSERT_EQ(makeFuzzySearchPinyin("lan2"), makeFuzzySearchPinyin("nang"));
+    ASSERT_EQ(makeFuzzySearchPinyin("xin1 qing2"), makeFuzzySearchPinyin("xingqin"));
+    ASSERT_EQ(makeFuzzySearchPinyin("feng1"), makeFuzzySearchPinyin("fen"));
+    ASSERT_EQ(u8"nunu", makeFuzzySearchPinyin("lu:4 lu:4"));
+    //folded a syllable at a time, so the g of guo is kept
+    ASSERT_NE(makeFuzzySearchPinyin("ban4 guo2"), makeFuzzySearchPinyin("ba1 nuo4"));
+    ASSERT_EQ(u8"banguo", makeFuzzySearchPinyin("ban guo"));
+    ASSERT_EQ(u8"banuo", makeFuzzySearchPinyin("ba'nuo"));
+    ASSERT_EQ(makeFuzzySearchPinyin("zhong1 guo2"), makeFuzzySearchPinyin("zhong guo"));
+    ASSERT_EQ(u8"sitoujianzibu", makeFuzzySearchPinyin("shi tou jian zi bu"));
+}
+
+TEST(PinyinUtils, initials) {
+    ASSERT_EQ(u8"zg", makeInitialsSearchPinyin(u8"zhōng,guó"));
+    ASSERT_EQ(u8"xxsh", makeInitialsSearchPinyin(u8"xué,xí,shēng,huó"));
+    ASSERT_EQ(u8"aen", makeInitialsSearchPinyin(u8"ài,ěr,lán"));
+    ASSERT_EQ(u8"usbsz", makeInitialsSearchPinyin(u8"u,s,b,shǒu,zhǐ"));
+    ASSERT_EQ(u8"l", makeInitialsSearchPinyin(u8"lǜ"));
+    ASSERT_EQ(u8"", makeInitialsSearchPinyin(u8""));
+}
+
+TEST(PinyinUtils, syllables) {
+    ASSERT_EQ(u8"zhong guo", makeSyllableSearchPinyin(u8"zhōng,guó"));
+    ASSERT_EQ(u8"lu se", makeSyllableSearchPinyin(u8"lǜ,sè"));
+    ASSERT_EQ(u8"u s b shou zhi", makeSyllableSearchPinyin(u8"u,s,b,shǒu,zhǐ"));
+    ASSERT_EQ(u8"shi tou jian zi bu", makeSyllableSearchPinyin(u8"shí,tou,jiǎn,zi,bù,"));
+
+    ASSERT_EQ(QStringList() << "zhong" << "g", splitTonelessSyllables("zhong g"));
+    ASSERT_EQ(QStringList() << "zh" << "guo", splitTonelessSyllables(" ZH  guo "));
+    ASSERT_EQ(QStringList() << "xi" << "an", splitTonelessSyllables("xi'an"));
+    ASSERT_EQ(QStringList() << "lu" << "se", splitTonelessSyllables("lu:4 se4"));
+    ASSERT_EQ(QStringList() << "zhong" << "guo", splitTonelessSyllables("zhongguo"));
+    ASSERT_EQ(QStringList() << "xian", splitTonelessSyllables("xian"));
+    ASSERT_EQ(QStringList() << "hello", splitTonelessSyllables("hello"));
+}
+
+TEST(PinyinUtils, searchQueries) {
+    PinyinSearchQueries queries;
+    makePinyinSearchQueries("Zhong guo", tfPinyinNoTones, true, queries);
+    ASSERT_EQ(u8"zhongguo", queries.text);
+    ASSERT_EQ(u8"zhongguo", queries.pinyin);
+    ASSERT_EQ(u8"\"^zhong* guo*\"", queries.syllables);
+    ASSERT_EQ(u8"zonguo", queries.fuzzy);
+
+    //one syllable has no phrase, and the fuzzy query is only made if asked for
+    makePinyinSearchQueries("xian", tfPinyinNoTones, false, queries);
+    ASSERT_EQ(u8"xian", queries.pinyin);
+    ASSERT_EQ(u8"", queries.syllables);
+    ASSERT_EQ(u8"", queries.fuzzy);
+
+    makePinyinSearchQueries(" zg ", tfPinyinInitials, true, queries);
+    ASSERT_EQ(u8"zg", queries.text);
+    ASSERT_EQ(u8"zg*", queries.pinyin);
+    ASSERT_EQ(u8"", queries.syllables);
+
+    makePinyinSearchQueries("zhong1 guo2", tfPinyinNumbers, true, queries);
+    ASSERT_EQ(u8"zhōngguó", queries.pinyin);
+    makePinyinSearchQueries(u8"Zhōng guó", tfPinyinTonemarks, true, queries);
+    ASSERT_EQ(u8"zhōngguó", queries.pinyin);
+}
+
+TEST(PinyinUtils, buffers) {
+    QString text = QString::fromUtf8(u8"a ü 中 \U00020000");
+    QByteArray utf8;
+    setUtf8(text.constData(), text.length(), utf8);
+    ASSERT_EQ(text.toUtf8(), utf8);
+    setUtf8(text.constData(), 1, utf8);
+    ASSERT_EQ(QByteArray("a"), utf8);
+
+    //cleared but still holding its capacity
+    QString buffer = "zhongguo";
+    buffer.reserve(64);
+    clearBuffer(buffer);
+    ASSERT_TRUE(buffer.isEmpty());
+    ASSERT_GE(buffer.capacity(), 64);
+
+    //the buffer forms match the ones making new strings
+    buffer = "xx";
+    appendInitialsSearchPinyin(QString(u8"zhōng,guó").constData(), 9, buffer);
+    ASSERT_EQ(u8"xxzg", buffer);
+    clearBuffer(buffer);
+    appendHanziSyllableSearchText(QString(u8"中国").constData(), 2, QString("zhong guo").constData(), 9, buffer);
+    ASSERT_EQ(u8"zhong中 guo国", buffer);
+}
+
+static QString segmentationText(const QString& text, const PinyinSegmentation& segmentation)
+{
+    QStringList syllables;
+    int i;
+    for (i=0; i < segmentation.count; i++) {
+        const PinyinSyllable& syllable = segmentation.syllables[i];
+        QString s = (syllable.id == PARTIAL_PINYIN_SYLLABLE) ? "?" + text.mid(syllable.start, syllable.length) :
+                                                               pinyinSyllableText(syllable.id);
+        if (syllable.tone != 0) s += QString::number(syllable.tone);
+        syllables.append(s);
+    }
+    return syllables.join(' ');
+}
+
+TEST(PinyinSyllables, segment) {
+    PinyinSegmentation alternatives[4];
+    ASSERT_EQ(4, segmentPinyin("xian", alternatives, 4));
+    ASSERT_EQ("xian", segmentationText("xian", alternatives[0]));
+    ASSERT_EQ("xi an", segmentationText("xian", alternatives[1]));
+
+    ASSERT_EQ(2, segmentPinyin("xi'an", alternatives, 4));
+    ASSERT_EQ("xi an", segmentationText("xi'an", alternatives[0]));
+
+    ASSERT_EQ(1, segmentPinyin("zhongg", alternatives, 4));
+    ASSERT_EQ("zhong ?g", segmentationText("zhongg", alternatives[0]));
+
+    ASSERT_EQ(4, segmentPinyin("fangan", alternatives, 4));
+    ASSERT_EQ("fang an", segmentationText("fangan", alternatives[0]));
+    ASSERT_EQ("fan gan", segmentationText("fangan", alternatives[1]));
+
+    ASSERT_EQ(1, segmentPinyin("lu:4 se4", alternatives, 1));
+    ASSERT_EQ("lv4 se4", segmentationText("lu:4 se4", alternatives[0]));
+    ASSERT_EQ(5, alternatives[0].syllables[1].start);
+    segmentPinyin(u8"nǚér", alternatives, 1);
+    ASSERT_EQ("nv3 er2", segmentationText(u8"nǚér", alternatives[0]));
+    segmentPinyin("Zhong1guo2", alternatives, 1);
+    ASSERT_EQ("zhong1 guo2", segmentationText("Zhong1guo2", alternatives[0]));
+
+    ASSERT_EQ(0, segmentPinyin("hello", alternatives, 4));
+    ASSERT_EQ(0, segmentPinyin(u8"中国", alternatives, 4));
+    ASSERT_EQ(0, segmentPinyin("1a", alternatives, 4));
+    ASSERT_EQ(0, segmentPinyin("", alternatives, 4));
+
+    ASSERT_EQ(QString("zhuang"), pinyinSyllableText(pinyinSyllableId("zhuang")));
+    ASSERT_EQ(pinyinSyllableId("lv"), pinyinSyllableId(u8"lü"));
+    ASSERT_EQ(-1, pinyinSyllableId("zh"));
+    ASSERT_TRUE(isVowellessSyllable(QString("Ng").constData(), 2));
+    ASSERT_TRUE(isVowellessSyllable(QString("hm").constData(), 2));
+    ASSERT_FALSE(isVowellessSyllable(QString("zh").constData(), 2));
+    ASSERT_FALSE(isVowellessSyllable(QString("hngg").constData(), 4));
+    ASSERT_TRUE(pinyinSyllableCount() > 400);
+}
+
+TEST(PinyinSyllables, toneMarkPosition) {
+    ASSERT_EQ(2, findToneMarkPosition(QString("Guai").constData(), 4));
+    ASSERT_EQ(2, findToneMarkPosition(QString("gui").constData(), 3));
+    ASSERT_EQ(2, findToneMarkPosition(QString(u8"lüe").constData(), 3));
+    ASSERT_EQ(1, findToneMarkPosition(QString("lu:").constData(), 3));
+    ASSERT_EQ(-1, findToneMarkPosition(QString("lv").constData(), 2));
+    ASSERT_EQ(-1, findToneMarkPosition(QString("r").constData(), 1));
+    //not syllables, but the same rules apply
+    ASSERT_EQ(1, findToneMarkPosition(QString("xxa").constData(), 3));
+}
+
+TEST(PinyinUtils, mixed) {
+    ASSERT_EQ(u8"zhong中 guo国", makeHanziSyllableSearchText(u8"中国", u8"zhōng,guó"));
+    ASSERT_EQ(u8"shi石 tou头 jian剪 zi子 bu布", makeHanziSyllableSearchText(u8"石头，剪子，布", u8"shí,tou,jiǎn,zi,bù"));
+    ASSERT_EQ(u8"yi伊 long隆 ma马 si斯 ke克", makeHanziSyllableSearchText(u8"伊隆·马斯克", u8"yī,lóng,mǎ,sī,kè"));
+
+    ASSERT_EQ(QStringList() << u8"中" << "guo", splitMixedSearchText(u8"中guo"));
+    ASSERT_EQ(QStringList() << "zhong" << u8"国", splitMixedSearchText(u8"zhong 国"));
+    ASSERT_EQ(QStringList() << u8"中" << u8"华" << "ren", splitMixedSearchText(u8"中华ren"));
+    ASSERT_EQ(QStringList() << u8"中" << "hua" << "r", splitMixedSearchText(u8"中 hua r"));
+}
+
+TEST(EnglishUtils, tokenizeEnglish) {
+    ASSERT_EQ(QStringList() << "to" << "run" << "of" << "a" << "machine", tokenizeEnglish("to run (of a machine)"));
+    ASSERT_EQ(QStringList() << "see" << "also" << "chéng" << "zhī", tokenizeEnglish(u8"see also 橙汁 chéng zhī"));
+    ASSERT_EQ(QStringList() << "cd" << "rom" << "3d", tokenizeEnglish("CD-ROM/3D"));
+    ASSERT_EQ(QStringList(), tokenizeEnglish(" / "));
+}
+
+TEST(EnglishUtils, stemEnglish) {
+    ASSERT_EQ("run", stemEnglish("run"));
+    ASSERT_EQ("run", stemEnglish("runs"));
+    ASSERT_EQ("run", stemEnglish("running"));
+    ASSERT_EQ("run", stemEnglish("ran"));
+    ASSERT_EQ(stemEnglish("make"), stemEnglish("making"));
+    ASSERT_EQ(stemEnglish("make"), stemEnglish("makes"));
+    ASSERT_EQ(stemEnglish("hope"), stemEnglish("hoped"));
+    ASSERT_EQ(stemEnglish("box"), stemEnglish("boxes"));
+    ASSERT_EQ(stemEnglish("agree"), stemEnglish("agreed"));
+    ASSERT_EQ(stemEnglish("study"), stemEnglish("studies"));
+    ASSERT_EQ(stemEnglish("study"), stemEnglish("studied"));
+    ASSERT_EQ(stemEnglish("die"), stemEnglish("died"));
+    ASSERT_EQ(stemEnglish("use"), stemEnglish("used"));
+    ASSERT_EQ("hop", stemEnglish("hopping"));
+    ASSERT_EQ("need", stemEnglish("need"));
+    ASSERT_EQ("sing", stemEnglish("sing"));
+    ASSERT_EQ("sing", stemEnglish("singing"));
+    ASSERT_EQ("bus", stemEnglish("bus"));
+    ASSERT_EQ("child", stemEnglish("children"));
+    ASSERT_EQ("use", stemEnglish("uses"));
+    ASSERT_EQ("use", stemEnglish("using"));
+    ASSERT_NE(stemEnglish("us"), stemEnglish("use"));
+    ASSERT_EQ("do", stemEnglish("doing"));
+    //also words of their own
+    ASSERT_EQ("rose", stemEnglish("rose"));
+    ASSERT_EQ("left", stemEnglish("left"));
+    ASSERT_EQ("saw", stemEnglish("saw"));
+}
+
+TEST(HeadwordIndex, find) {
+    HeadwordIndex index;
+    //added in word_rank order
+    index.addEntry(10, u8"學生", u8"学生");
+    index.addEntry(11, u8"大學", u8"大学");
+    index.addEntry(12, u8"中國", u8"中国");
+    index.addEntry(13, u8"學學", u8"学学");
+    index.addEntry(14, u8"人", u8"人");
+    index.build();
+
+    ASSERT_EQ(QList<int>() << 10 << 11 << 13, index.find(u8"学", 100));
+    ASSERT_EQ(QList<int>() << 10 << 11 << 13, index.find(u8"學", 100));
+    ASSERT_EQ(QList<int>() << 10 << 11, index.find(u8"学", 2));
+    ASSERT_EQ(QList<int>() << 11, index.find(u8"大学", 100));
+    ASSERT_EQ(QList<int>() << 10, index.find(u8"学生", 100));
+    ASSERT_EQ(QList<int>() << 14, index.find(u8"人", 100));
+    ASSERT_EQ(QList<int>(), index.find(u8"学国", 100));
+    ASSERT_EQ(QList<int>(), index.find(u8"生大", 100));
+    ASSERT_EQ(QList<int>(), index.find("", 100));
+
+    HeadwordIndex loaded;
+    ASSERT_TRUE(loaded.deserialize(index.serialize()));
+    ASSERT_EQ(5, loaded.entryCount());
+    ASSERT_EQ(QList<int>() << 12, loaded.find(u8"国", 100));
+    ASSERT_FALSE(loaded.deserialize(QByteArray("junk")));
+}
+
+TEST(HeadwordIndex, findPattern) {
+    HeadwordIndex index;
+    index.addEntry(20, u8"一塵不染", u8"一尘不染");
+    index.addEntry(21, u8"中國", u8"中国");
+    index.addEntry(22, u8"一心一意", u8"一心一意");
+    index.addEntry(23, u8"中華民國", u8"中华民国");
+    index.addEntry(24, u8"一絲不苟", u8"一丝不苟");
+    index.build();
+
+    ASSERT_EQ(QList<int>() << 20 << 24, index.findPattern(u8"一?不?", 100));
+    ASSERT_EQ(QList<int>() << 20, index.findPattern(u8"一?不?", 1));
+    ASSERT_EQ(QList<int>() << 21 << 23, index.findPattern(u8"中*国", 100));
+    ASSERT_EQ(QList<int>() << 21 << 23, index.findPattern(u8"中*國", 100));
+    ASSERT_EQ(QList<int>() << 21, index.findPattern(u8"中?", 100));
+    ASSERT_EQ(QList<int>() << 22, index.findPattern(u8"*一意", 100));
+    ASSERT_EQ(QList<int>() << 20 << 22 << 23 << 24, index.findPattern("????", 100));
+    ASSERT_EQ(QList<int>() << 20 << 21 << 22 << 23 << 24, index.findPattern("*", 100));
+    ASSERT_EQ(QList<int>(), index.findPattern(u8"一?不", 100));
+    ASSERT_EQ(QList<int>(), index.findPattern(u8"?国?", 100));
+}
+
+TEST(PinyinUtils, lookupKey) {
+    ASSERT_EQ(u8"中国", makeLookupKey(u8" 中国 "));
+    ASSERT_EQ(u8"中國", makeLookupKey(u8"中國"));
+    ASSERT_EQ("zhongguo", makeLookupKey("Zhong guo"));
+    ASSERT_EQ("zhongguo", makeLookupKey("zhongguo"));
+    ASSERT_EQ(u8"zhōngguó", makeLookupKey("zhong1 guo2"));
+    ASSERT_EQ(u8"zhōngguó", makeLookupKey(u8"Zhōng guó"));
+    ASSERT_EQ(u8"nǚér", makeLookupKey(u8"nǚ'ér"));
+    ASSERT_EQ(u8"nǚér", makeLookupKey("nu:3 er2"));
+}
+
+static QStringList segmentTexts(const QString& text, const QList<TextSegment>& segments)
+{
+    QStringList result;
+    int i;
+    for (i=0; i < segments.count(); i++) {
+        result.append(text.mid(segments[i].start, segments[i].length));
+    }
+    return result;
+}
+
+TEST(Segmenter, segment) {
+    Segmenter segmenter;
+    segmenter.addWord(u8"我", 1, 3);
+    segmenter.addWord(u8"我们", 2, 10);
+    segmenter.addWord(u8"们", 3, 900);
+    segmenter.addWord(u8"是", 4, 5);
+    segmenter.addWord(u8"中国", 5, 20);
+    segmenter.addWord(u8"中國", 5, 20);
+    segmenter.addWord(u8"中国人", 6, 100);
+    segmenter.addWord(u8"国人", 7, 500);
+    segmenter.addWord(u8"人", 8, 30);
+    segmenter.addWord(u8"卡拉OK", 9, 5000);
+    segmenter.build();
+    ASSERT_EQ(9, segmenter.wordCount());
+
+    QString text = u8"我们是中国人。";
+    QList<TextSegment> segments = segmenter.segment(text);
+    ASSERT_EQ(QStringList() << u8"我们" << u8"是" << u8"中国人" << u8"。", segmentTexts(text, segments));
+    ASSERT_EQ(QList<int>() << 2, segments[0].wordsKeys);
+    ASSERT_EQ(QList<int>() << 6, segments[2].wordsKeys);
+    ASSERT_EQ(QList<int>(), segments[3].wordsKeys);
+
+    text = u8"他是中國人, 唱卡拉OK abc";
+    ASSERT_EQ(QStringList() << u8"他" << u8"是" << u8"中國" << u8"人" << ", " << u8"唱" << u8"卡拉OK" << " " << "abc",
+              segmentTexts(text, segmenter.segment(text)));
+
+    ASSERT_EQ(0, segmenter.segment("").count());
+
+    //long enough to be split up, and the same either way
+    QString longText;
+    int i;
+    for (i=0; i < 5000; i++) {
+        longText += u8"我们是中国人。\n";
+    }
+    QList<TextSegment> serial = segmenter.segment(longText);
+    QList<TextSegment> parallel = segmenter.segmentParallel(longText);
+    ASSERT_EQ(serial.count(), parallel.count());
+    for (i=0; i < serial.count(); i++) {
+        ASSERT_EQ(serial[i].start, parallel[i].start);
+        ASSERT_EQ(serial[i].length, parallel[i].length);
+    }
+
+    //one long run with no sentence end, scanned once rather than from
+    //every position in it
+    QString rule(200000, QChar('='));
+    QElapsedTimer timer;
+    timer.start();
+    segments = segmenter.segment(u8"我们" + rule + "abc");
+    ASSERT_EQ(3, segments.count());
+    ASSERT_EQ(rule.length(), segments[1].length);
+    ASSERT_LT(timer.elapsed(), 2000);
+}
+
+static DetailsPayload makePayload(const QString& english)
+{
+    DetailsPayload details;
+    details.extraInfo.insert("english", english);
+    return details;
+}
+
+TEST(DetailsCache, lru) {
+    DetailsPayload first = makePayload(QString(100, 'a'));
+    int bytes = DetailsCache::estimateBytes(first);
+    ASSERT_TRUE(bytes > 200);
+
+    //room for exactly three
+    DetailsCache cache(bytes * 3);
+    cache.insert(1, first);
+    cache.insert(2, makePayload(QString(100, 'b')));
+    cache.insert(3, makePayload(QString(100, 'c')));
+    ASSERT_EQ(3, cache.count());
+    ASSERT_EQ(bytes * 3, cache.bytes());
+
+    //using 1 leaves 2 as the least recently used
+    DetailsPayload found;
+    ASSERT_TRUE(cache.find(1, found));
+    ASSERT_EQ(QString(100, 'a'), found.extraInfo.value("english").toString());
+    cache.insert(4, makePayload(QString(100, 'd')));
+    ASSERT_TRUE(cache.contains(1));
+    ASSERT_FALSE(cache.contains(2));
+    ASSERT_TRUE(cache.contains(3));
+    ASSERT_TRUE(cache.contains(4));
+    ASSERT_FALSE(cache.find(2, found));
+    ASSERT_EQ(1u, cache.hits());
+    ASSERT_EQ(1u, cache.misses());
+
+    //bigger than the whole budget, so not kept
+    cache.insert(5, makePayload(QString(1000, 'e')));
+    ASSERT_FALSE(cache.contains(5));
+    ASSERT_EQ(3, cache.count());
+
+    cache.setMaxBytes(bytes);
+    ASSERT_EQ(1, cache.count());
+}
+
+//classifies each code point on its own, the slow way
+static uint classifyEachChar(const QString& text)
+{
+    uint classes = 0;
+    int i;
+    for (i=0; i < text.length(); i++) {
+        if (text.at(i).isHighSurrogate() && (i + 1 < text.length()) && text.at(i + 1).isLowSurrogate()) {
+            classes |= classifyChar(QChar::surrogateToUcs4(text.at(i), text.at(i + 1)));
+            i++;
+        } else {
+            classes |= classifyChar(text.at(i).unicode());
+        }
+    }
+    return classes;
+}
+
+TEST(CharClass, classify) {
+    ASSERT_EQ((uint)ccHan, classifyChar(0x4E2D));     //中
+    ASSERT_EQ((uint)ccHan, classifyChar(0x3007));     //〇
+    ASSERT_EQ((uint)ccHan, classifyChar(0x20000));    //𠀀
+    ASSERT_EQ((uint)ccLatinLetter, classifyChar('q'));
+    ASSERT_EQ((uint)ccUmlautU, classifyChar(0x00FC));
+    ASSERT_EQ((uint)ccToneMarkedVowel, classifyChar(0x01D8));  //ǘ
+    ASSERT_EQ((uint)ccToneMarkedVowel, classifyChar(0x00C0));  //À
+    ASSERT_EQ((uint)ccToneDigit, classifyChar('3'));
+    ASSERT_EQ(0u, classifyChar('6'));
+    ASSERT_EQ((uint)ccPunctuation, classifyChar(0x3001));    //、
+    ASSERT_EQ(0u, classifyChar(0x3002));                     //。
+    ASSERT_EQ(0u, classifyChar(0xD840));                     //a lone surrogate
+
+    //the table agrees with Qt for every BMP code point
+    uint c;
+    for (c=0; c < 0x10000; c++) {
+        ASSERT_EQ(QChar::script(c) == QChar::Script_Han, (classifyChar(c) & ccHan) != 0) << c;
+    }
+    ASSERT_TRUE(charClassTableSize() < 16384);
+
+    //the block scan gives the same answer wherever things fall in a block
+    QStringList texts;
+    texts << "" << "a" << "zhong1guo2" << "the quick brown fox, jumps" << u8"nǚ'ér" << u8"中国"
+          << u8"abcdefg中hijklmn" << u8"abcdefgh中" << u8"abcdefg𠀀xyz" << u8"1234567、" << "[]^_`@{|}~"
+          << u8"ABCDEFGHIJKLMNOP·" << u8"他是中國人, 唱卡拉OK abc ǚ";
+    int i;
+    for (i=0; i < texts.count(); i++) {
+        int offset;
+        for (offset=0; offset < 8; offset++) {
+            QString text = QString(offset, ' ') + texts[i];
+            ASSERT_EQ(classifyEachChar(text), classifyText(text)) << text.toStdString();
+        }
+    }
+    ASSERT_EQ(0u, classifyText("[]^_`@{|}~  00000000"));
+    ASSERT_EQ((uint)(ccHan | ccLatinLetter), classifyText(u8"中guo"));
+}
+
+//the regular expressions isHanzi() and isPunctuation() used to run
+static QRegularExpression s_oldHanziRegExp("\\p{Han}");
+static QRegularExpression s_oldPunctuationRegExp("[,·、]");
+
+TEST(CharClass, benchmark) {
+    QStringList corpus;
+    corpus << u8"中华人民共和国" << u8"一心一意" << u8"卡拉OK" << u8"你好，世界。" << u8"中guo"
+           << "zhong1guo2" << u8"zhōngguó" << "zhongguo" << "zg" << u8"nǚ'ér"
+           << "to be able to" << u8"used in 一意孤行|一意孤行[yi1 yi4 gu1 xing2]"
+           << u8"越南" << u8"ＵＳＢ手指" << u8"一、二、三" << u8"克里斯蒂娜·费尔南德斯";
+
+    const int iterations = 2000;
+    int regexHits = 0;
+    int tableHits = 0;
+    QElapsedTimer timer;
+
+    //per character, as when finding the component characters of a word
+    timer.start();
+    int n, i, j;
+    for (n=0; n < iterations; n++) {
+        for (i=0; i < corpus.count(); i++) {
+            for (j=0; j < corpus[i].length(); j++) {
+                QString c = corpus[i].at(j);
+                if (s_oldHanziRegExp.match(c).hasMatch()) regexHits++;
+                if (s_oldPunctuationRegExp.match(c).hasMatch()) regexHits++;
+            }
+        }
+    }
+    qint64 regexNs = timer.nsecsElapsed();
+
+    timer.restart();
+    for (n=0; n < iterations; n++) {
+        for (i=0; i < corpus.count(); i++) {
+            for (j=0; j < corpus[i].length(); j++) {
+                QString c = corpus[i].at(j);
+                if (isHanzi(c)) tableHits++;
+                if (isPunctuation(c)) tableHits++;
+            }
+        }
+    }
+    qint64 tableNs = timer.nsecsElapsed();
+    ASSERT_EQ(regexHits, tableHits);
+
+    //whole strings, as determineTextFormat() does on every keystroke
+    timer.restart();
+    regexHits = 0;
+    for (n=0; n < iterations; n++) {
+        for (i=0; i < corpus.count(); i++) {
+            if (s_oldHanziRegExp.match(corpus[i]).hasMatch()) regexHits++;
+        }
+    }
+    qint64 regexStringNs = timer.nsecsElapsed();
+
+    timer.restart();
+    tableHits = 0;
+    for (n=0; n < iterations; n++) {
+        for (i=0; i < corpus.count(); i++) {
+            if (classifyText(corpus[i]) & ccHan) tableHits++;
+        }
+    }
+    qint64 tableStringNs = timer.nsecsElapsed();
+    ASSERT_EQ(regexHits, tableHits);
+
+    int chars = 0;
+    for (i=0; i < corpus.count(); i++) {
+        chars += corpus[i].length();
+    }
+    printf("per character: regex %.1f ns, table %.1f ns\n",
+           (double)regexNs / (iterations * chars), (double)tableNs / (iterations * chars));
+    printf("per string: regex %.1f ns, table %.1f ns\n",
+           (double)regexStringNs / (iterations * corpus.count()),
+           (double)tableStringNs / (iterations * corpus.count()));
+}
+
+
+//a few entries put through dbcreator, for the tests that search a real db
+static const char* s_testCedict =
+    "# CC-CEDICT\n"
+    "中國 中国 [Zhong1 guo2] /China/\n"
+    "中華 中华 [Zhong1 hua2] /China (alternative name)/\n"
+    "上海 上海 [Shang4 hai3] /Shanghai municipality/\n"
+    "什麼 什么 [shen2 me5] /what?/\n"
+    "嗯 嗯 [ng4] /(interjection) yes/\n"
+    "學生 学生 [xue2 sheng5] /student/schoolchild/\n"
+    "大學 大学 [da4 xue2] /university/college/\n"
+    "玫瑰 玫瑰 [mei2 gui1] /rose (flower)/\n"
+    "上升 上升 [shang4 sheng1] /to rise/to go up/\n"
+    "用 用 [yong4] /to use/to make use of/\n"
+    "我們 我们 [wo3 men5] /we/us/\n";
+
+static QString testDbDir()
+{
+    return QDir::tempPath() + "/ChineseDictTest-" + QString::number(QCoreApplication::applicationPid());
+}
+
+static DictDb* testDb()
+{
+    static DictDb* s_testDb = NULL;
+    if (s_testDb != NULL) return s_testDb;
+
+    QString dir = testDbDir();
+    QDir().mkpath(dir);
+    QFile cedict(dir + "/cedict.u8");
+    cedict.open(QIODevice::WriteOnly);
+    cedict.write(s_testCedict);
+    cedict.close();
+    QFile rank(dir + "/rank.num");
+    rank.open(QIODevice::WriteOnly);
+    rank.write(u8"1 100.00 我们\n2 90.00 中国\n3 80.00 学生\n");
+    rank.close();
+    QFile::remove(dir + "/words.db");
+    if (!createDb(QString(dir + "/words.db").toUtf8().constData(),
+                  QString(dir + "/cedict.u8").toUtf8().constData(),
+                  QString(dir + "/rank.num").toUtf8().constData())) {
+        return NULL;
+    }
+    s_testDb = new DictDb(dir + "/words.db");
+    return s_testDb;
+}
+
+//the simplified headwords found for search, best first
+static QStringList searchSimplified(const QString& search, bool english = false)
+{
+    QStringList headwords;
+    DictDb* db = testDb();
+    if (db == NULL) return headwords;
+    QObjectList* results = english ? db->matchEnglish(search) : db->matchChinese(search);
+    int i;
+    for (i=0; i < results->count(); i++) {
+        headwords.append(static_cast<SearchResult*>(results->at(i))->simplified());
+    }
+    qDeleteAll(*results);
+    delete results;
+    return headwords;
+}
+
+TEST(DictDb, initials) {
+    ASSERT_TRUE(testDb() != NULL);
+    ASSERT_TRUE(searchSimplified("zg").contains(u8"中国"));
+    //initials too, z and h, rather than the start of zhōng
+    ASSERT_TRUE(searchSimplified("zh").contains(u8"中华"));
+    ASSERT_FALSE(searchSimplified("zh").contains(u8"中国"));
+    ASSERT_TRUE(searchSimplified("sh").contains(u8"上海"));
+    ASSERT_FALSE(searchSimplified("sh").contains(u8"什么"));
+    //a syllable with no vowel
+    ASSERT_TRUE(searchSimplified("ng").contains(u8"嗯"));
+    //typed with a space, so the start of each syllable
+    ASSERT_TRUE(searchSimplified("zh g").contains(u8"中国"));
+}
+
+TEST(DictDb, englishPrefix) {
+    ASSERT_TRUE(testDb() != NULL);
+    ASSERT_TRUE(searchSimplified("stud", true).contains(u8"学生"));
+    ASSERT_TRUE(searchSimplified("univ", true).contains(u8"大学"));
+    //rare enough to have its own postings read
+    ASSERT_EQ(u8"大学", searchSimplified("university", true).value(0));
+    ASSERT_TRUE(searchSimplified("to", true).contains(u8"上升"));
+}
+
+TEST(DictDb, englishTerms) {
+    ASSERT_TRUE(testDb() != NULL);
+    //"to" is in far more entries than "rise", so its postings are looked up
+    //for the candidates "rise" gives
+    ASSERT_EQ(QStringList() << u8"上升", searchSimplified("to rise ", true));
+    ASSERT_EQ(QStringList() << u8"上升", searchSimplified("rise to ", true));
+    ASSERT_EQ(u8"上升", searchSimplified("to go u", true).value(0));
+    ASSERT_EQ(QStringList(), searchSimplified("rise china ", true));
+}
+
+TEST(DictDb, wildcards) {
+    ASSERT_TRUE(testDb() != NULL);
+    QStringList contains = searchSimplified(u8"*学");
+    ASSERT_TRUE(contains.contains(u8"大学"));
+    ASSERT_TRUE(contains.contains(u8"学生"));
+    //full width, as typed with a chinese input method
+    ASSERT_EQ(contains, searchSimplified(u8"＊学"));
+    ASSERT_EQ(QStringList() << u8"学生", searchSimplified(u8"学?"));
+    ASSERT_EQ(QStringList() << u8"学生", searchSimplified(u8"学？"));
+    ASSERT_EQ(QStringList() << u8"大学", searchSimplified(u8"＊大？"));
+}
+
+TEST(DictDb, englishIrregular) {
+    ASSERT_TRUE(testDb() != NULL);
+    ASSERT_EQ(QStringList() << u8"玫瑰", searchSimplified("rose ", true));
+    ASSERT_EQ(QStringList() << u8"用", searchSimplified("uses ", true));
+    ASSERT_EQ(QStringList() << u8"我们", searchSimplified("us ", true));
+}
+
+TEST(DictDb, fuzzy) {
+    ASSERT_TRUE(testDb() != NULL);
+    testDb()->onFuzzyPinyinChanged(true);
+    QStringList zongguo = searchSimplified("zongguo");
+    QStringList sanghai = searchSimplified("sang hai");
+    QStringList xueshen = searchSimplified("xueshen");
+    testDb()->onFuzzyPinyinChanged(false);
+    ASSERT_TRUE(zongguo.contains(u8"中国"));
+    ASSERT_TRUE(sanghai.contains(u8"上海"));
+    ASSERT_TRUE(xueshen.contains(u8"学生"));
+}
+
+TEST(BatchLookup, lookup) {
+    ASSERT_TRUE(testDb() != NULL);
+    BatchLookup lookup(testDbDir() + "/words.db");
+    ASSERT_TRUE(lookup.isOpen());
+    QStringList words;
+    words << u8"中国" << "zhong1 guo2" << "xuesheng" << u8"大學" << "nonsense" << "ng";
+    //keys that aren't there, so the walk has gaps to seek over
+    int i;
+    for (i=0; i < 40; i++) words << "a" + QString::number(i) << "zz" + QString::number(i);
+    QList<QList<LookupEntry> > entries = lookup.lookup(words);
+    ASSERT_EQ(words.count(), entries.count());
+    ASSERT_EQ(u8"中国", entries[0].value(0).simplified);
+    ASSERT_EQ(u8"中国", entries[1].value(0).simplified);
+    ASSERT_EQ(u8"学生", entries[2].value(0).simplified);
+    ASSERT_EQ(u8"大学", entries[3].value(0).simplified);
+    ASSERT_TRUE(entries[4].isEmpty());
+    ASSERT_EQ(u8"嗯", entries[5].value(0).simplified);
+    for (i=6; i < words.count(); i++) ASSERT_TRUE(entries[i].isEmpty());
+}